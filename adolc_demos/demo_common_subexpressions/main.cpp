@@ -0,0 +1,380 @@
+// ------------------------------------------------------------------------------------------------------------------ //
+// Example showing how to remove common subexpressions from the trace while it is recorded
+//
+// The sphere parametrization of demo_mimo_scalar evaluates cos(u), sin(u) and cos(v) several times and ADOL-C records
+// every evaluation as a separate operation, so every forward and reverse sweep repeats the work. This demo extends the
+// function with the two tangent vectors of the surface (which use the same trigonometric terms again) and records it
+// twice without changing its code: once directly with adoubles and once into a small expression graph. The graph is
+// written to the ADOL-C trace through a table of subexpressions that hashes each operation by (operation, nodes of the
+// arguments, constant) and maps an operation that is already in the table to the node that was written, so the
+// duplicate never reaches the trace. Since the result is an ordinary trace with fewer operations, it remains valid for
+// all the forward and reverse drivers.
+//
+// The arguments are identified by their node in the graph and not by the location of their adouble, which ADOL-C
+// reuses once the adouble is destroyed.
+//
+// ------------------------------------------------------------------------------------------------------------------ //
+
+
+// Include libraries
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <unordered_map>
+#include <adolc/adolc.h>
+
+
+// Define namespaces
+using namespace std;                // cout, endl
+using namespace std::chrono;        // nanoseconds, system_clock, seconds
+
+
+// Radius of the sphere
+static double R = 2.00;
+
+
+// Operations of the expression graph (the constant operand of the _D_ operations is stored in the node)
+enum Opcode {CONSTANT, INDEPENDENT, MULT_A_A, MULT_D_A, SIN, COS};
+
+struct Node {
+    Opcode op;
+    int arg1, arg2;
+    double constant;
+    double value;
+};
+
+
+// Expression graph recorded between begin() and end(), analogous to an ADOL-C trace
+class Graph {
+
+public:
+
+    vector<Node> nodes;
+    vector<int> independents, dependents;
+
+    void begin() { nodes.clear(); independents.clear(); dependents.clear(); active = this; }
+    void end() { active = nullptr; }
+
+    static int add(Opcode op, int arg1, int arg2, double constant, double value) {
+        active->nodes.push_back({op, arg1, arg2, constant, value});
+        return (int) active->nodes.size() - 1;
+    }
+
+    static Graph * active;
+
+};
+
+Graph * Graph::active = nullptr;
+
+
+// Active variable of the expression graph: each operation evaluates its value and appends a node to the active graph
+class Var {
+
+public:
+
+    Var() : id(-1) {}
+    Var(double c) : id(Graph::add(CONSTANT, -1, -1, c, c)) {}
+
+    double value() const { return Graph::active->nodes[node()].value; }
+
+    Var & operator<<=(double x) {
+        id = Graph::add(INDEPENDENT, -1, -1, 0.00, x);
+        Graph::active->independents.push_back(id);
+        return *this;
+    }
+
+    Var & operator>>=(double &y) {
+        Graph::active->dependents.push_back(node());
+        y = value();
+        return *this;
+    }
+
+    Var & operator*=(const Var &b) { return *this = *this * b; }
+
+    friend Var operator*(const Var &a, const Var &b) { return make(MULT_A_A, a, b, 0.00, a.value() * b.value()); }
+
+    // Mixed operations are mapped to the same operations that ADOL-C records (a - c as a + (-c), a / c as (1/c) * a)
+    friend Var operator*(double c, const Var &a) { return make(MULT_D_A, a, a, c, c * a.value()); }
+    friend Var operator*(const Var &a, double c) { return c * a; }
+    friend Var operator/(const Var &a, double c) { return (1.00/c) * a; }
+
+    friend Var sin(const Var &a) { return make(SIN, a, a, 0.00, sin(a.value())); }
+    friend Var cos(const Var &a) { return make(COS, a, a, 0.00, cos(a.value())); }
+
+private:
+
+    // Node of the variable. A default-constructed variable is zero and records its constant only when it is read, so
+    // the variables that are assigned before they are read (such as the independent variables) do not leave a node
+    int node() const {
+        if (id < 0) { id = Graph::add(CONSTANT, -1, -1, 0.00, 0.00); }
+        return id;
+    }
+
+    static Var make(Opcode op, const Var &a, const Var &b, double constant, double value) {
+        Var result;
+        result.id = Graph::add(op, a.node(), b.node(), constant, value);
+        return result;
+    }
+
+    mutable int id;
+
+};
+
+
+// Key of an operation of the graph: opcode, nodes that hold the arguments and bit pattern of the constant operand.
+// The constants are compared bit by bit, so that -0.0 and 0.0 are different keys (1/x and atan2 depend on the sign)
+struct NodeKey {
+    Opcode op;
+    int arg1, arg2;
+    uint64_t constant;
+    NodeKey(Opcode op, int arg1, int arg2, double c) : op(op), arg1(arg1), arg2(arg2) {
+        memcpy(&constant, &c, sizeof(constant));
+    }
+    bool operator==(const NodeKey &other) const {
+        return op == other.op && arg1 == other.arg1 && arg2 == other.arg2 && constant == other.constant;
+    }
+};
+
+struct NodeKeyHash {
+    size_t operator()(const NodeKey &key) const {
+        size_t h = hash<int>()(key.op);
+        h = 31*h + hash<int>()(key.arg1);
+        h = 31*h + hash<int>()(key.arg2);
+        h = 31*h + hash<uint64_t>()(key.constant);
+        return h;
+    }
+};
+
+
+// Number of operations written to the trace and number of duplicates that were mapped to an earlier operation
+struct SubexpressionCounts {
+    size_t recorded = 0;
+    size_t reused = 0;
+};
+
+
+// Write the graph to an ADOL-C trace without duplicates. Each operation is looked up in a table by its key, where the
+// arguments are replaced by the nodes that were kept for them: if an equal operation was already written, the node is
+// mapped to it, otherwise it is written and added to the table. The keys are node indices of the graph, which do not
+// change during the pass, unlike the locations of the adoubles that are reused when an adouble is destroyed
+SubexpressionCounts replay(const Graph &graph, short tag, double * yp) {
+
+    int size = (int) graph.nodes.size();
+    vector<int> kept(size);                     // Node that was written for each node of the graph
+    vector<adouble *> a(size, nullptr);
+    unordered_map<NodeKey, int, NodeKeyHash> table;
+    SubexpressionCounts counts;
+    auto y = new adouble[graph.dependents.size()];
+
+    trace_on(tag);
+
+    for (int k = 0; k < size; ++k) {
+        const Node &node = graph.nodes[k];
+        const double c = node.constant;
+        if (node.op == INDEPENDENT) {           // The independent variables are never merged
+            kept[k] = k;
+            a[k] = new adouble;
+            *a[k] <<= node.value;
+            continue;
+        }
+        int arg1 = (node.arg1 >= 0) ? kept[node.arg1] : -1;
+        int arg2 = (node.arg2 >= 0) ? kept[node.arg2] : -1;
+        if (node.op == MULT_A_A && arg2 < arg1) { swap(arg1, arg2); }   // a*b and b*a share the entry
+        auto entry = table.emplace(NodeKey(node.op, arg1, arg2, c), k);
+        if (!entry.second) {
+            kept[k] = entry.first->second;
+            ++counts.reused;
+            continue;
+        }
+        kept[k] = k;
+        ++counts.recorded;
+        switch (node.op) {
+            case CONSTANT:    a[k] = new adouble(c); break;
+            case MULT_A_A:    a[k] = new adouble(*a[arg1] * *a[arg2]); break;
+            case MULT_D_A:    a[k] = new adouble(c * *a[arg1]); break;
+            case SIN:         a[k] = new adouble(sin(*a[arg1])); break;
+            case COS:         a[k] = new adouble(cos(*a[arg1])); break;
+            default:          break;
+        }
+    }
+
+    // Each dependent variable gets its own location, as in the direct trace (two of them may share the same node)
+    for (size_t i = 0; i < graph.dependents.size(); ++i) {
+        y[i] = *a[kept[graph.dependents[i]]];
+        y[i] >>= yp[i];
+    }
+
+    trace_off();
+
+    for (adouble * p : a) { delete p; }
+    delete[] y;
+    return counts;
+
+}
+
+
+// Define the function to be differentiated: sphere r(u,v) = [R*cos(u)*cos(v), R*sin(u)*cos(v), R*sin(v)] and the
+// tangent vectors dr/du and dr/dv of the surface (written as they would be typed, without reusing any term)
+template<typename T>
+T * my_function(T * IN) {
+    T u = IN[0];
+    T v = IN[1];
+    auto f = new T[9];
+    f[0] = R*cos(u)*cos(v);
+    f[1] = R*sin(u)*cos(v);
+    f[2] = R*sin(v);
+    f[3] = -R*sin(u)*cos(v);
+    f[4] = R*cos(u)*cos(v);
+    f[5] = 0.00;
+    f[6] = -R*cos(u)*sin(v);
+    f[7] = -R*sin(u)*sin(v);
+    f[8] = R*cos(v);
+    return f;
+}
+
+
+int main() {
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Initialize problem variables
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Parameter values
+    double u = 0.50, v = 0.25;
+
+    // Initialize passive variables
+    int m = 9, n = 2;
+    auto xp = new double[n];    // Independent vector
+    auto yp = new double[m];    // Dependent vector
+    xp[0] = u;
+    xp[1] = v;
+
+    // Initialize active variables
+    auto x = new adouble[n];
+    auto y = new adouble[m];
+
+    // Number of repetitions of the Jacobian evaluation
+    int repetitions = 100000;
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Active section for automatic differentiation
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Start tracing floating point operations
+    trace_on(0);    // Start of the active section
+
+    // Assign independent variables
+    x[0] <<= xp[0];
+    x[1] <<= xp[1];
+
+    // Evaluate the body of the differentiated code
+    auto temp = my_function(x);
+    for (int i = 0; i < m; ++i) { y[i] = temp[i]; }
+    delete[] temp;
+
+    // Assign dependent variables
+    for (int i = 0; i < m; ++i) { y[i] >>= yp[i]; }
+
+    trace_off();    // End of the active section
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Record the same function into the expression graph and write it to a trace without duplicates
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    Graph graph;
+    graph.begin();
+    auto xv = new Var[n];
+    for (int i = 0; i < n; ++i) {
+        xv[i] <<= xp[i];
+    }
+    auto fv = my_function(xv);
+    for (int i = 0; i < m; ++i) {
+        fv[i] >>= yp[i];
+    }
+    graph.end();
+    delete[] fv;
+    delete[] xv;
+
+    SubexpressionCounts cse = replay(graph, 1, yp);
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Compare the traces and the Jacobians
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Number of operations of each trace
+    size_t counts[2][STAT_SIZE];
+    tapestats(0, counts[0]);
+    tapestats(1, counts[1]);
+
+    // Evaluate the Jacobian of both traces several times
+    double **J[2], time[2];
+    for (int tag = 0; tag < 2; ++tag) {
+        J[tag] = myalloc(m, n);
+        auto t_start = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < repetitions; ++r) { jacobian(tag, m, n, xp, J[tag]); }
+        auto t_end = std::chrono::high_resolution_clock::now();
+        time[tag] = std::chrono::duration<double>(t_end - t_start).count();
+    }
+
+    // Maximum difference between the Jacobians
+    double error = 0.00;
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < n; ++j) { error = fmax(error, fabs(J[0][i][j] - J[1][i][j])); }
+    }
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Print the results
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    cout << setw(20) << "Trace" << setw(20) << "Operations" << setw(20) << "Locations" << setw(20) << "Time [ms]" << endl;
+    cout << setw(20) << "As written" << setw(20) << counts[0][NUM_OPERATIONS] << setw(20) << counts[0][NUM_LOCATIONS]
+         << setw(20) << time[0]*1000 << endl;
+    cout << setw(20) << "Without duplicates" << setw(20) << counts[1][NUM_OPERATIONS] << setw(20) << counts[1][NUM_LOCATIONS]
+         << setw(20) << time[1]*1000 << endl;
+    cout << endl;
+    cout << "The replay wrote " << cse.recorded << " operations of the graph and merged " << cse.reused
+         << " duplicates" << endl;
+    cout << "The maximum difference between the Jacobians is " << error << endl;
+    cout << endl;
+
+    cout << "Jacobian of the trace without duplicates" << endl;
+    cout.precision(6);
+    cout.setf(ios::fixed);
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < n; ++j) { cout << setw(20) << J[1][i][j]; }
+        cout << endl;
+    }
+    cout << endl << endl;
+
+
+
+    /* Observations:
+     *
+     *  The Jacobians of both traces are identical because the reused operations compute exactly the same values
+     *  The trace without duplicates has fewer operations, so every sweep of every driver does less work. The time
+     *  reduction is proportional to the number of operations removed
+     *  Only identical operations on identical arguments are merged. Terms that are equal after algebraic manipulation
+     *  (for example -R*sin(u)*cos(v) and -(R*sin(u)*cos(v))) are not detected
+     *  The function is not rewritten for the table: the duplicates are found in the recorded graph, where the nodes of
+     *  the arguments never change, so the same pass works for any function that can be evaluated with Var
+     *
+     * */
+
+    return 0;
+
+
+}
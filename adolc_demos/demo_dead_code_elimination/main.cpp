@@ -0,0 +1,354 @@
+// ------------------------------------------------------------------------------------------------------------------ //
+// Example showing how to remove the operations that do not reach any dependent variable before they are traced
+//
+// Everything evaluated with adoubles between trace_on() and trace_off() is recorded, including diagnostics and side
+// computations that are not used by any dependent variable, and every forward and reverse sweep repeats that work.
+// ADOL-C does not provide a pass to modify a finished trace, so this demo records the function into a small expression
+// graph first (the Var type below evaluates the operations and stores them as nodes), runs a backward liveness pass
+// from the dependent variables and writes only the live operations to the ADOL-C trace. The adoubles of the replayed
+// operations are destroyed right after their last use, so ADOL-C reuses their locations and the location numbering of
+// the trace stays compact.
+//
+// The trace with the diagnostics (recorded directly with adoubles) and the trace without the dead operations are
+// compared in terms of the number of operations, the number of live locations and the time to evaluate the gradient
+//
+// The expression graph of this demo (Node, Graph and Var) is the scaffold reused by the other demos that record a
+// graph, which only change the opcodes and the operators of Var.
+//
+// ------------------------------------------------------------------------------------------------------------------ //
+
+
+// Include libraries
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <adolc/adolc.h>
+
+
+// Define namespaces
+using namespace std;                // cout, endl
+using namespace std::chrono;        // nanoseconds, system_clock, seconds
+
+
+// Operations of the expression graph (the constant operand of the _D_ operations is stored in the node)
+enum Opcode {CONSTANT, INDEPENDENT, PLUS_A_A, MINUS_A_A, MULT_A_A, DIV_A_A, PLUS_D_A, MINUS_D_A, MULT_D_A, DIV_D_A,
+             NEG, EXP, LOG, SQRT, SIN, COS};
+
+struct Node {
+    Opcode op;
+    int arg1, arg2;
+    double constant;
+    double value;
+};
+
+
+// Expression graph recorded between begin() and end(), analogous to an ADOL-C trace
+class Graph {
+
+public:
+
+    vector<Node> nodes;
+    vector<int> independents, dependents;
+
+    void begin() { nodes.clear(); independents.clear(); dependents.clear(); active = this; }
+    void end() { active = nullptr; }
+
+    static int add(Opcode op, int arg1, int arg2, double constant, double value) {
+        active->nodes.push_back({op, arg1, arg2, constant, value});
+        return (int) active->nodes.size() - 1;
+    }
+
+    static Graph * active;
+
+};
+
+Graph * Graph::active = nullptr;
+
+
+// Active variable of the expression graph: each operation evaluates its value and appends a node to the active graph
+class Var {
+
+public:
+
+    Var() : id(-1) {}
+    Var(double c) : id(Graph::add(CONSTANT, -1, -1, c, c)) {}
+
+    double value() const { return Graph::active->nodes[node()].value; }
+
+    Var & operator<<=(double x) {
+        id = Graph::add(INDEPENDENT, -1, -1, 0.00, x);
+        Graph::active->independents.push_back(id);
+        return *this;
+    }
+
+    Var & operator>>=(double &y) {
+        Graph::active->dependents.push_back(node());
+        y = value();
+        return *this;
+    }
+
+    Var & operator+=(const Var &b) { return *this = *this + b; }
+    Var & operator-=(const Var &b) { return *this = *this - b; }
+    Var & operator*=(const Var &b) { return *this = *this * b; }
+    Var & operator/=(const Var &b) { return *this = *this / b; }
+
+    friend Var operator+(const Var &a, const Var &b) { return make(PLUS_A_A, a, b, 0.00, a.value() + b.value()); }
+    friend Var operator-(const Var &a, const Var &b) { return make(MINUS_A_A, a, b, 0.00, a.value() - b.value()); }
+    friend Var operator*(const Var &a, const Var &b) { return make(MULT_A_A, a, b, 0.00, a.value() * b.value()); }
+    friend Var operator/(const Var &a, const Var &b) { return make(DIV_A_A, a, b, 0.00, a.value() / b.value()); }
+
+    // Mixed operations are mapped to the same operations that ADOL-C records (a - c as a + (-c), a / c as (1/c) * a)
+    friend Var operator+(double c, const Var &a) { return make(PLUS_D_A, a, a, c, c + a.value()); }
+    friend Var operator+(const Var &a, double c) { return c + a; }
+    friend Var operator-(double c, const Var &a) { return make(MINUS_D_A, a, a, c, c - a.value()); }
+    friend Var operator-(const Var &a, double c) { return (-c) + a; }
+    friend Var operator*(double c, const Var &a) { return make(MULT_D_A, a, a, c, c * a.value()); }
+    friend Var operator*(const Var &a, double c) { return c * a; }
+    friend Var operator/(double c, const Var &a) { return make(DIV_D_A, a, a, c, c / a.value()); }
+    friend Var operator/(const Var &a, double c) { return (1.00/c) * a; }
+
+    friend Var operator-(const Var &a) { return make(NEG, a, a, 0.00, -a.value()); }
+    friend Var exp(const Var &a) { return make(EXP, a, a, 0.00, exp(a.value())); }
+    friend Var log(const Var &a) { return make(LOG, a, a, 0.00, log(a.value())); }
+    friend Var sqrt(const Var &a) { return make(SQRT, a, a, 0.00, sqrt(a.value())); }
+    friend Var sin(const Var &a) { return make(SIN, a, a, 0.00, sin(a.value())); }
+    friend Var cos(const Var &a) { return make(COS, a, a, 0.00, cos(a.value())); }
+
+private:
+
+    // Node of the variable. A default-constructed variable is zero and records its constant only when it is read, so
+    // the variables that are assigned before they are read (such as the independent variables) do not leave a node
+    int node() const {
+        if (id < 0) { id = Graph::add(CONSTANT, -1, -1, 0.00, 0.00); }
+        return id;
+    }
+
+    static Var make(Opcode op, const Var &a, const Var &b, double constant, double value) {
+        Var result;
+        result.id = Graph::add(op, a.node(), b.node(), constant, value);
+        return result;
+    }
+
+    mutable int id;
+
+};
+
+
+// Backward liveness pass: an operation is live if its result reaches a dependent variable
+vector<bool> live_operations(const Graph &graph) {
+    vector<bool> live(graph.nodes.size(), false);
+    for (int d : graph.dependents) { live[d] = true; }
+    for (int k = (int) graph.nodes.size() - 1; k >= 0; --k) {
+        const Node &node = graph.nodes[k];
+        if (!live[k] || node.arg1 < 0) { continue; }
+        live[node.arg1] = true;
+        live[node.arg2] = true;
+    }
+    return live;
+}
+
+
+// Write the live operations of the graph to an ADOL-C trace. The adouble of each operation is destroyed after its last
+// use so that ADOL-C can reuse its location for the following operations
+void replay(const Graph &graph, const vector<bool> &live, short tag, double * yp) {
+
+    // Index of the last operation that uses each result (the dependent variables are used at the end of the trace)
+    int size = (int) graph.nodes.size();
+    vector<int> last_use(size, -1);
+    for (int k = 0; k < size; ++k) {
+        const Node &node = graph.nodes[k];
+        if (live[k] && node.arg1 >= 0) { last_use[node.arg1] = last_use[node.arg2] = k; }
+    }
+    for (int d : graph.dependents) { last_use[d] = size; }
+
+    vector<adouble *> a(size, nullptr);
+    auto release = [&](int arg, int k) {
+        if (arg >= 0 && a[arg] != nullptr && last_use[arg] <= k) { delete a[arg]; a[arg] = nullptr; }
+    };
+
+    trace_on(tag);
+
+    for (int k = 0; k < size; ++k) {
+        const Node &node = graph.nodes[k];
+        if (!live[k] && node.op != INDEPENDENT) { continue; }   // The independent variables are always declared
+        const double c = node.constant;
+        switch (node.op) {
+            case CONSTANT:    a[k] = new adouble(c); break;
+            case INDEPENDENT: a[k] = new adouble; *a[k] <<= node.value; break;
+            case PLUS_A_A:    a[k] = new adouble(*a[node.arg1] + *a[node.arg2]); break;
+            case MINUS_A_A:   a[k] = new adouble(*a[node.arg1] - *a[node.arg2]); break;
+            case MULT_A_A:    a[k] = new adouble(*a[node.arg1] * *a[node.arg2]); break;
+            case DIV_A_A:     a[k] = new adouble(*a[node.arg1] / *a[node.arg2]); break;
+            case PLUS_D_A:    a[k] = new adouble(c + *a[node.arg1]); break;
+            case MINUS_D_A:   a[k] = new adouble(c - *a[node.arg1]); break;
+            case MULT_D_A:    a[k] = new adouble(c * *a[node.arg1]); break;
+            case DIV_D_A:     a[k] = new adouble(c / *a[node.arg1]); break;
+            case NEG:         a[k] = new adouble(-*a[node.arg1]); break;
+            case EXP:         a[k] = new adouble(exp(*a[node.arg1])); break;
+            case LOG:         a[k] = new adouble(log(*a[node.arg1])); break;
+            case SQRT:        a[k] = new adouble(sqrt(*a[node.arg1])); break;
+            case SIN:         a[k] = new adouble(sin(*a[node.arg1])); break;
+            case COS:         a[k] = new adouble(cos(*a[node.arg1])); break;
+        }
+        release(node.arg1, k);
+        release(node.arg2, k);
+        release(k, k);      // Independent variables that are not used by any live operation
+    }
+
+    for (size_t i = 0; i < graph.dependents.size(); ++i) { *a[graph.dependents[i]] >>= yp[i]; }
+
+    trace_off();
+
+    for (adouble * p : a) { delete p; }
+
+}
+
+
+// Define the function to be differentiated: f(x) = e^[(x0+x1+...+xn)/n]
+// The function also computes two diagnostics that are not used by the dependent variable: the norm of x and a
+// consistency check of the trigonometric identity sin^2 + cos^2 = 1
+template<typename T>
+T my_function(T * x, int n, T &norm, T &check) {
+    T sum = 0, squares = 0, identity = 0;
+    for (int i = 0; i < n; ++i) {
+        sum += x[i];
+        squares += x[i]*x[i];
+        identity += sin(x[i])*sin(x[i]) + cos(x[i])*cos(x[i]);
+    }
+    norm = sqrt(squares);
+    check = identity/n - 1.00;
+    T f = exp(sum/n);
+    return f;
+};
+
+
+int main() {
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Initialize problem variables
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Initialize passive variables
+    int m = 1, n = 10000;       // Set n equal to the desired number of independent variables
+    auto xp = new double[n];    // Independent vector
+    auto yp = new double[m];    // Dependent vector
+
+    // Set the value of the independent variables
+    for (int i = 0; i < n; ++i) {
+        xp[i] = 1.00 + 0.10*(i % 7);
+    }
+
+    // Number of repetitions of the gradient evaluation
+    int repetitions = 100;
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Active section for automatic differentiation (direct trace, including the diagnostics)
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Initialize active variables
+    auto x = new adouble[n];
+    auto y = new adouble[m];
+    adouble norm, check;
+
+    // Start tracing floating point operations
+    trace_on(0);    // Start of the active section
+
+    // Assign independent variables
+    for (int i = 0; i < n; ++i) {
+        x[i] <<= xp[i];
+    }
+
+    // Evaluate the body of the differentiated code
+    y[0] = my_function(x, n, norm, check);
+
+    // Assign dependent variables
+    y[0] >>= yp[0];
+
+    trace_off();    // End of the active section
+
+    cout << "Diagnostics of the direct trace: norm = " << norm.value() << ", check = " << check.value() << endl;
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Record the expression graph, remove the dead operations and write the trace
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Record the graph with the same code (the diagnostics are evaluated and can still be printed)
+    Graph graph;
+    graph.begin();
+    auto xv = new Var[n];
+    Var yv, norm_v, check_v;
+    for (int i = 0; i < n; ++i) {
+        xv[i] <<= xp[i];
+    }
+    yv = my_function(xv, n, norm_v, check_v);
+    yv >>= yp[0];
+    cout << "Diagnostics of the graph:        norm = " << norm_v.value() << ", check = " << check_v.value() << endl;
+    graph.end();
+
+    // Backward liveness pass from the dependent variables
+    auto t_start = std::chrono::high_resolution_clock::now();
+    vector<bool> live = live_operations(graph);
+    auto t_end = std::chrono::high_resolution_clock::now();
+    double time_liveness = std::chrono::duration<double>(t_end - t_start).count();
+    size_t eliminated = 0;
+    for (size_t k = 0; k < live.size(); ++k) {
+        if (!live[k] && graph.nodes[k].op != INDEPENDENT) { ++eliminated; }
+    }
+
+    // Write the live operations to the trace
+    replay(graph, live, 1, yp);
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Compare both traces
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    size_t counts[2][STAT_SIZE];
+    double **g = myalloc2(2, n), time[2];
+    for (int tag = 0; tag < 2; ++tag) {
+        tapestats(tag, counts[tag]);
+        t_start = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < repetitions; ++r) { gradient(tag, n, xp, g[tag]); }
+        t_end = std::chrono::high_resolution_clock::now();
+        time[tag] = std::chrono::duration<double>(t_end - t_start).count() / repetitions;
+    }
+
+    double error = 0.00;
+    for (int i = 0; i < n; ++i) { error = fmax(error, fabs(g[0][i] - g[1][i])); }
+
+    cout << endl;
+    cout << "The liveness pass eliminated " << eliminated << " of the " << graph.nodes.size() << " graph operations in "
+         << time_liveness*1000 << " milliseconds" << endl;
+    cout << endl;
+    cout << setw(20) << "Trace" << setw(20) << "Operations" << setw(20) << "Max live locs" << setw(20) << "gradient [ms]" << endl;
+    cout << setw(20) << "Direct" << setw(20) << counts[0][NUM_OPERATIONS] << setw(20) << counts[0][NUM_MAX_LIVES]
+         << setw(20) << time[0]*1000 << endl;
+    cout << setw(20) << "Live operations" << setw(20) << counts[1][NUM_OPERATIONS] << setw(20) << counts[1][NUM_MAX_LIVES]
+         << setw(20) << time[1]*1000 << endl;
+    cout << endl;
+    cout << "The maximum difference between the gradients is " << error << endl;
+    cout << endl << endl;
+
+
+
+    /* Observations:
+     *
+     *  The diagnostics take most of the operations of the direct trace, although they do not change the gradient
+     *  The trace without the dead operations gives the same gradient and every sweep is proportionally faster
+     *  The liveness pass and the replay are done once, their cost is amortized over all the driver calls
+     *  The diagnostics are still available after recording the graph because the Var type evaluates every operation
+     *
+     * */
+
+    return 0;
+
+
+}
@@ -0,0 +1,354 @@
+// ------------------------------------------------------------------------------------------------------------------ //
+// Example showing how to compute full symmetric derivative tensors by univariate Taylor interpolation
+//
+// All the derivatives up to order d are obtained from a single hov_forward() sweep along the minimal set of
+// univariate directions s with nonnegative integer components and |s| = s_1 + ... + s_n = d. The k-th Taylor
+// coefficient of f(x + t s) is a homogeneous polynomial of degree k in the direction
+//
+//      f_k(s) = sum_{|j|=k} (1/j!) D^j f(x) s^j
+//
+// so the mixed partial derivatives D^j f(x) are recovered by interpolating f_k(s) over the set of directions.
+// The directions and the interpolation weights only depend on (n, d) and are computed once and cached.
+// The results are returned in compressed symmetric storage: one entry per multi-index j with |j| <= d.
+//
+// ------------------------------------------------------------------------------------------------------------------ //
+
+
+// Include libraries
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+#include <utility>
+#include <adolc/adolc.h>
+
+
+// Define namespaces
+using namespace std;                // cout, endl
+using namespace std::chrono;        // nanoseconds, system_clock, seconds
+
+
+// Quick factorial implementation
+int factorial(int n) { return (n == 1 || n == 0) ? 1 : factorial(n - 1) * n; }
+
+
+// Directions, multi-indices and interpolation weights for n independent variables and derivatives up to order d
+struct TensorSeeds {
+    int n, d, p;                                // Number of variables, highest order and number of directions
+    vector<vector<int>> directions;             // Univariate directions s with |s| = d
+    vector<vector<vector<int>>> multi_indices;  // Multi-indices j with |j| = k for each order k = 0, ..., d
+    vector<int> offset;                         // Position of the first entry of order k in the compressed storage
+    map<vector<int>, int> position;             // Position of each multi-index in the compressed storage
+    vector<double **> weights;                  // Interpolation weights of order k (size M_k x p)
+    double ***X;                                // Seed array for hov_forward (size n x p x d)
+};
+
+
+// Generate all the multi-indices of n components with |j| = k in lexicographically decreasing order
+void generate_multi_indices(int n, int k, vector<int> &current, vector<vector<int>> &out) {
+    int i = current.size();
+    if (i == n-1) {
+        current.push_back(k);
+        out.push_back(current);
+        current.pop_back();
+        return;
+    }
+    for (int value = k; value >= 0; --value) {
+        current.push_back(value);
+        generate_multi_indices(n, k-value, current, out);
+        current.pop_back();
+    }
+}
+
+
+// Solve A*W = B for the matrix W (stored in B) by Gaussian elimination with partial pivoting
+void solve(double **A, double **B, int size, int nrhs) {
+    for (int col = 0; col < size; ++col) {
+        int pivot = col;
+        for (int row = col+1; row < size; ++row) {
+            if (fabs(A[row][col]) > fabs(A[pivot][col])) { pivot = row; }
+        }
+        swap(A[col], A[pivot]);
+        swap(B[col], B[pivot]);
+        for (int row = col+1; row < size; ++row) {
+            double factor = A[row][col] / A[col][col];
+            for (int j = col; j < size; ++j) { A[row][j] -= factor*A[col][j]; }
+            for (int j = 0; j < nrhs; ++j) { B[row][j] -= factor*B[col][j]; }
+        }
+    }
+    for (int col = size-1; col >= 0; --col) {
+        for (int j = 0; j < nrhs; ++j) {
+            for (int k = col+1; k < size; ++k) { B[col][j] -= A[col][k]*B[k][j]; }
+            B[col][j] /= A[col][col];
+        }
+    }
+}
+
+
+// Compute the directions and interpolation weights for (n, d) or return the cached ones
+const TensorSeeds & tensor_seeds(int n, int d) {
+
+    // Return the cached seeds if they were already computed
+    static map<pair<int, int>, TensorSeeds> cache;
+    auto found = cache.find(make_pair(n, d));
+    if (found != cache.end()) { return found->second; }
+
+    // Generate the directions and the multi-indices of each order
+    TensorSeeds &seeds = cache[make_pair(n, d)];
+    seeds.n = n;
+    seeds.d = d;
+    vector<int> current;
+    generate_multi_indices(n, d, current, seeds.directions);
+    seeds.p = seeds.directions.size();
+    seeds.multi_indices.resize(d+1);
+    for (int k = 0; k <= d; ++k) {
+        generate_multi_indices(n, k, current, seeds.multi_indices[k]);
+        seeds.offset.push_back(k == 0 ? 0 : seeds.offset[k-1] + seeds.multi_indices[k-1].size());
+        for (size_t jj = 0; jj < seeds.multi_indices[k].size(); ++jj) {
+            seeds.position[seeds.multi_indices[k][jj]] = seeds.offset[k] + jj;
+        }
+    }
+
+    // Seed the first order Taylor coefficients with the directions
+    int p = seeds.p;
+    seeds.X = myalloc3(n, p, d);
+    for (int i = 0; i < n; ++i) {
+        for (int dir = 0; dir < p; ++dir) {
+            for (int deg = 0; deg < d; ++deg) {
+                seeds.X[i][dir][deg] = (deg == 0) ? seeds.directions[dir][i] : 0.00;
+            }
+        }
+    }
+
+    // Interpolation weights of order k: least-squares inverse W = (A^T A)^-1 A^T of the matrix A[dir][jj] = s^j
+    // The system is consistent and A has full column rank because the directions are unisolvent for order d
+    seeds.weights.resize(d+1, nullptr);
+    for (int k = 1; k <= d; ++k) {
+        int size = seeds.multi_indices[k].size();
+        double **A = myalloc2(p, size);
+        for (int dir = 0; dir < p; ++dir) {
+            for (int jj = 0; jj < size; ++jj) {
+                A[dir][jj] = 1.00;
+                for (int i = 0; i < n; ++i) {
+                    A[dir][jj] *= pow(seeds.directions[dir][i], seeds.multi_indices[k][jj][i]);
+                }
+            }
+        }
+        double **AtA = myalloc2(size, size);
+        double **W = myalloc2(size, p);
+        for (int a = 0; a < size; ++a) {
+            for (int b = 0; b < size; ++b) {
+                AtA[a][b] = 0.00;
+                for (int dir = 0; dir < p; ++dir) { AtA[a][b] += A[dir][a]*A[dir][b]; }
+            }
+            for (int dir = 0; dir < p; ++dir) { W[a][dir] = A[dir][a]; }
+        }
+        solve(AtA, W, size, p);
+        seeds.weights[k] = W;
+        myfree2(A);
+        myfree2(AtA);
+    }
+
+    return seeds;
+
+}
+
+
+// Compute the derivatives D^j f_i(x) for all |j| <= d with a single hov_forward sweep
+// The array tensor must have m rows with the compressed symmetric size returned by tensor_size(n, d)
+int derivative_tensor(short tag, int m, int n, int d, double *x, double **tensor) {
+
+    // Get the (cached) directions and interpolation weights
+    const TensorSeeds &seeds = tensor_seeds(n, d);
+    int p = seeds.p;
+
+    // Propagate the univariate Taylor polynomials along all the directions
+    double *y = myalloc1(m);
+    double ***Y = myalloc3(m, p, d);
+    int rc = hov_forward(tag, m, n, d, p, x, seeds.X, y, Y);
+
+    // Interpolate the mixed partial derivatives of each order
+    for (int i = 0; i < m; ++i) {
+        tensor[i][0] = y[i];
+        for (int k = 1; k <= d; ++k) {
+            for (size_t jj = 0; jj < seeds.multi_indices[k].size(); ++jj) {
+                double coefficient = 0.00;
+                for (int dir = 0; dir < p; ++dir) {
+                    coefficient += seeds.weights[k][jj][dir]*Y[i][dir][k-1];
+                }
+                double scale = 1.00;
+                for (int value : seeds.multi_indices[k][jj]) { scale *= factorial(value); }
+                tensor[i][seeds.offset[k] + jj] = scale*coefficient;
+            }
+        }
+    }
+
+    myfree1(y);
+    myfree3(Y);
+    return rc;
+
+}
+
+
+// Number of entries of the compressed symmetric storage of all the derivatives up to order d
+int tensor_size(int n, int d) {
+    const TensorSeeds &seeds = tensor_seeds(n, d);
+    return seeds.offset[d] + seeds.multi_indices[d].size();
+}
+
+
+// Position of the derivative D^j f in the compressed symmetric storage
+int tensor_position(int n, int d, const vector<int> &j) {
+    return tensor_seeds(n, d).position.at(j);
+}
+
+
+// Coefficients of the exponent of the function to be differentiated
+double coefficient(int i, int n) { return (i+1.00)/n; }
+
+
+// Define the function to be differentiated: f(x) = e^[a0*x0 + a1*x1 + ... + an*xn] with ai = (i+1)/n
+adouble my_function(adouble * x, int n) {
+    adouble sum;
+    for (int i = 0; i < n; ++i) {
+        sum += coefficient(i, n)*x[i];
+    }
+    adouble f = exp(sum);
+    return f;
+};
+
+double my_function(const double * x, int n) {
+    double sum = 0.0;
+    for (int i = 0; i < n; ++i) {
+        sum += coefficient(i, n)*x[i];
+    }
+    double f = exp(sum);
+    return f;
+};
+
+
+int main() {
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Initialize problem variables
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Initialize passive variables
+    int m = 1, n = 4;
+    auto xp = new double[n];    // Independent vector
+    auto yp = new double[m];    // Dependent vector
+
+    // Set the value of the independent variables
+    for (int i = 0; i < n; ++i) {
+        xp[i] = 0.50;
+    }
+
+    // Initialize active variables
+    auto x = new adouble[n];
+    auto y = new adouble[m];
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Active section for automatic differentiation
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Set the tag for the Automatic Differentiation trace
+    int tag = 0;
+
+    // Start tracing floating point operations
+    trace_on(tag);  // Start of the active section
+
+    // Assign independent variables
+    for (int i = 0; i < n; ++i) {
+        x[i] <<= xp[i];
+    }
+
+    // Evaluate the body of the differentiated code
+    y[0] = my_function(x, n);
+
+    // Assign dependent variables
+    y[0] >>= yp[0];
+
+    trace_off();    // End of the active section
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Compute all the derivatives up to third order
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Define the order of the highest derivative
+    int degree = 3;
+
+    // Compute the directions and weights twice to show the effect of caching them (the first call fills the cache)
+    cout.precision(8);
+    cout.setf(ios::fixed);
+    for (int call = 0; call < 2; ++call) {
+        auto t_start = std::chrono::high_resolution_clock::now();
+        tensor_seeds(n, degree);
+        auto t_end = std::chrono::high_resolution_clock::now();
+        auto elapsed_seconds = std::chrono::duration<double>(t_end - t_start).count();
+        cout << "The elapsed time of tensor_seeds() call " << call+1 << " was " << elapsed_seconds*1000
+             << " milliseconds" << endl;
+    }
+
+    // Declare the compressed derivative tensor
+    double **tensor = myalloc2(m, tensor_size(n, degree));
+
+    // Compute the derivative tensor twice, both calls use the cached directions and weights
+    for (int call = 0; call < 2; ++call) {
+        auto t_start = std::chrono::high_resolution_clock::now();
+        derivative_tensor(tag, m, n, degree, xp, tensor);
+        auto t_end = std::chrono::high_resolution_clock::now();
+        auto elapsed_seconds = std::chrono::duration<double>(t_end - t_start).count();
+        cout << "The elapsed time of derivative_tensor() call " << call+1 << " was " << elapsed_seconds*1000
+             << " milliseconds" << endl;
+    }
+    cout << endl;
+
+    // Print the size of the problem
+    int dense_size = 0;
+    for (int k = 0, entries = 1; k <= degree; ++k, entries *= n) { dense_size += entries; }
+    cout << "Number of univariate Taylor directions:        " << tensor_seeds(n, degree).p << endl;
+    cout << "Number of dense tensor entries up to order " << degree << ":  " << dense_size << endl;
+    cout << "Number of compressed tensor entries:           " << tensor_size(n, degree) << endl;
+    cout << endl;
+
+    // Compare the AD and the analytic derivatives: D^j f = a^j f
+    cout << "Derivative tensor computed by univariate Taylor interpolation" << endl;
+    cout << setw(10) << "Order" << setw(20) << "Multi-index" << setw(20) << "AD derivative" << setw(25) << "Analytic derivative" << endl;
+    for (int k = 0; k <= degree; ++k) {
+        for (const vector<int> &j : tensor_seeds(n, degree).multi_indices[k]) {
+            string label = "(";
+            double analytic = my_function(xp, n);
+            for (int i = 0; i < n; ++i) {
+                label += to_string(j[i]) + (i < n-1 ? "," : ")");
+                analytic *= pow(coefficient(i, n), j[i]);
+            }
+            cout << setw(10) << k << setw(20) << label << setw(20) << tensor[0][tensor_position(n, degree, j)]
+                 << setw(25) << analytic << endl;
+        }
+    }
+    cout << endl << endl;
+
+
+
+    /* Observations:
+     *
+     *  A single hov_forward() sweep with binomial(n+d-1, d) directions gives all the derivatives up to order d
+     *  The number of directions grows much more slowly than the n^d entries of the dense tensor
+     *  The first call to tensor_seeds() computes the directions and solves the interpolation systems, the second call
+     *  only looks them up in the cache. Every call to derivative_tensor() after the first one reuses the cached seeds,
+     *  so its cost is the hov_forward() sweep and the interpolation
+     *
+     * */
+
+    return 0;
+
+
+}
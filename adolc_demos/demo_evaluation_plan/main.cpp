@@ -0,0 +1,322 @@
+// ------------------------------------------------------------------------------------------------------------------ //
+// Example showing how to reuse the setup of the driver calls when the same trace is evaluated many times
+//
+// The demos allocate the seed and result arrays, fill them and call the drivers inside the loops, and every call of a
+// reverse driver is preceded by a zos_forward sweep, even when the point did not change. For a small trace evaluated
+// thousands of times (for example the dynamics of a model-predictive-control loop), this setup costs as much as the
+// sweep itself. This demo implements an evaluation plan created once per (tag, mode, p, degree): it checks the
+// dimensions of the trace, preallocates the arrays in the layout expected by the drivers and exposes execute(x, seeds,
+// y, out) with flat arrays. The plans of the reverse modes keep the Taylor coefficients of the last point and only
+// repeat the zos_forward sweep when the point changes.
+//
+// ADOL-C opens the trace and initializes its internal buffers inside each driver call, this part of the overhead can
+// not be removed from the calling code and remains in both variants
+//
+// ------------------------------------------------------------------------------------------------------------------ //
+
+
+// Include libraries
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <adolc/adolc.h>
+
+
+// Define namespaces
+using namespace std;                // cout, endl
+using namespace std::chrono;        // nanoseconds, system_clock, seconds
+
+
+// Radius of the sphere
+static double R = 2.00;
+
+
+// Driver evaluated by a plan
+enum Mode {ZOS_FORWARD, FOS_FORWARD, FOV_FORWARD, HOS_FORWARD, FOS_REVERSE, FOV_REVERSE};
+
+
+// Evaluation plan of a trace: the arrays of the driver are allocated once and reused by every call of execute()
+// Layout of the flat arrays (p is the number of directions and d the degree):
+//  - FOS_FORWARD: seeds[n], out[m]
+//  - FOV_FORWARD: seeds[i*p + dir], out[j*p + dir]
+//  - HOS_FORWARD: seeds[i*d + k], out[j*d + k] (Taylor coefficients of degree k+1)
+//  - FOS_REVERSE: seeds[m], out[n]
+//  - FOV_REVERSE: seeds[dir*m + j], out[dir*n + i]
+class EvalPlan {
+
+public:
+
+    EvalPlan(short tag, Mode mode, int m, int n, int p = 1, int degree = 1)
+            : tag(tag), mode(mode), m(m), n(n), p(p), d(degree) {
+
+        // Check the dimensions of the trace once
+        size_t counts[STAT_SIZE];
+        tapestats(tag, counts);
+        valid = (counts[NUM_INDEPENDENTS] == (size_t) n && counts[NUM_DEPENDENTS] == (size_t) m);
+
+        x = myalloc1(n);
+        y = myalloc1(m);
+        x_last = myalloc1(n);
+        switch (mode) {
+            case ZOS_FORWARD: break;
+            case FOS_FORWARD: a1 = myalloc1(n); b1 = myalloc1(m); break;
+            case FOV_FORWARD: A2 = myalloc2(n, p); B2 = myalloc2(m, p); break;
+            case HOS_FORWARD: A2 = myalloc2(n, d); B2 = myalloc2(m, d); break;
+            case FOS_REVERSE: a1 = myalloc1(m); b1 = myalloc1(n); break;
+            case FOV_REVERSE: A2 = myalloc2(p, m); B2 = myalloc2(p, n); break;
+        }
+
+    }
+
+    ~EvalPlan() {
+        myfree1(x); myfree1(y); myfree1(x_last);
+        if (a1 != nullptr) { myfree1(a1); myfree1(b1); }
+        if (A2 != nullptr) { myfree2(A2); myfree2(B2); }
+    }
+
+    EvalPlan(const EvalPlan &) = delete;
+    EvalPlan & operator=(const EvalPlan &) = delete;
+
+    bool is_valid() const { return valid; }
+
+    // Number of zos_forward sweeps done by the reverse modes
+    int forward_sweeps() const { return sweeps; }
+
+    // Evaluate the driver at the point x. Returns the return code of the driver (or -1 if the plan is not valid)
+    int execute(const double * xp, const double * seeds, double * yp, double * out) {
+        if (!valid) { return -1; }
+        int rc = 0;
+        memcpy(x, xp, n*sizeof(double));
+        switch (mode) {
+            case ZOS_FORWARD:
+                rc = zos_forward(tag, m, n, 0, x, y);
+                break;
+            case FOS_FORWARD:
+                memcpy(a1, seeds, n*sizeof(double));
+                rc = fos_forward(tag, m, n, 0, x, a1, y, b1);
+                memcpy(out, b1, m*sizeof(double));
+                break;
+            case FOV_FORWARD:
+            case HOS_FORWARD: {
+                int q = (mode == FOV_FORWARD) ? p : d;
+                for (int i = 0; i < n; ++i) { memcpy(A2[i], seeds + i*q, q*sizeof(double)); }
+                if (mode == FOV_FORWARD) { rc = fov_forward(tag, m, n, p, x, A2, y, B2); }
+                else { rc = hos_forward(tag, m, n, d, 0, x, A2, y, B2); }
+                for (int j = 0; j < m; ++j) { memcpy(out + j*q, B2[j], q*sizeof(double)); }
+                break;
+            }
+            case FOS_REVERSE:
+            case FOV_REVERSE:
+                // The Taylor coefficients written by the last zos_forward sweep are valid until the point changes
+                if (!kept || memcmp(x, x_last, n*sizeof(double)) != 0) {
+                    rc = zos_forward(tag, m, n, 1, x, y);
+                    memcpy(x_last, x, n*sizeof(double));
+                    kept = true;
+                    ++sweeps;
+                }
+                if (mode == FOS_REVERSE) {
+                    memcpy(a1, seeds, m*sizeof(double));
+                    fos_reverse(tag, m, n, a1, b1);
+                    memcpy(out, b1, n*sizeof(double));
+                } else {
+                    for (int dir = 0; dir < p; ++dir) { memcpy(A2[dir], seeds + dir*m, m*sizeof(double)); }
+                    fov_reverse(tag, m, n, p, A2, B2);
+                    for (int dir = 0; dir < p; ++dir) { memcpy(out + dir*n, B2[dir], n*sizeof(double)); }
+                }
+                break;
+        }
+        if (yp != nullptr) { memcpy(yp, y, m*sizeof(double)); }
+        return rc;
+    }
+
+private:
+
+    short tag;
+    Mode mode;
+    int m, n, p, d;
+    bool valid;
+    bool kept = false;
+    int sweeps = 0;
+    double *x, *y, *x_last;
+    double *a1 = nullptr, *b1 = nullptr;
+    double **A2 = nullptr, **B2 = nullptr;
+
+};
+
+
+// Define the function to be differentiated: sphere r(u,v) = [R*cos(u)*cos(v), R*sin(u)*cos(v), R*sin(v)]
+adouble * my_function(adouble * IN) {
+    adouble u = IN[0];
+    adouble v = IN[1];
+    auto f = new adouble[3];
+    f[0] = R*cos(u)*cos(v);
+    f[1] = R*sin(u)*cos(v);
+    f[2] = R*sin(v);
+    return f;
+}
+
+
+int main() {
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Initialize problem variables
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Initialize passive variables
+    int m = 3, n = 2;
+    auto xp = new double[n];    // Independent vector
+    auto yp = new double[m];    // Dependent vector
+    xp[0] = 0.50;
+    xp[1] = 0.25;
+
+    // Initialize active variables
+    auto x = new adouble[n];
+    auto y = new adouble[m];
+
+    // Number of calls of each driver (the trace is small, so the setup of each call is significant)
+    int calls = 100000;
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Active section for automatic differentiation
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Set the tag for the Automatic Differentiation trace
+    int tag = 0;
+
+    // Start tracing floating point operations
+    trace_on(tag);  // Start of the active section
+
+    // Assign independent variables
+    x[0] <<= xp[0];
+    x[1] <<= xp[1];
+
+    // Evaluate the body of the differentiated code
+    auto temp = my_function(x);
+    for (int i = 0; i < m; ++i) { y[i] = temp[i]; }
+
+    // Assign dependent variables
+    for (int i = 0; i < m; ++i) { y[i] >>= yp[i]; }
+
+    trace_off();    // End of the active section
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Jacobian with the vector forward mode: driver called as in the other demos vs evaluation plan
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Identity seed matrix in the flat layout of the plan
+    int p = n;
+    auto seeds = new double[n*p];
+    for (int i = 0; i < n; ++i) {
+        for (int dir = 0; dir < p; ++dir) { seeds[i*p + dir] = (i == dir) ? 1.00 : 0.00; }
+    }
+    auto J_direct = new double[m*p];
+    auto J_plan = new double[m*p];
+
+    // Allocate, fill and free the arrays in every call
+    auto t_start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < calls; ++r) {
+        double **X = myalloc2(n, p);
+        double **Y = myalloc2(m, p);
+        for (int i = 0; i < n; ++i) {
+            for (int dir = 0; dir < p; ++dir) { X[i][dir] = seeds[i*p + dir]; }
+        }
+        fov_forward(tag, m, n, p, xp, X, yp, Y);
+        for (int j = 0; j < m; ++j) {
+            for (int dir = 0; dir < p; ++dir) { J_direct[j*p + dir] = Y[j][dir]; }
+        }
+        myfree2(X);
+        myfree2(Y);
+    }
+    auto t_end = std::chrono::high_resolution_clock::now();
+    double time_fov_direct = std::chrono::duration<double>(t_end - t_start).count() / calls;
+
+    // Evaluation plan created once
+    EvalPlan fov_plan(tag, FOV_FORWARD, m, n, p);
+    if (!fov_plan.is_valid()) {
+        cout << "The dimensions of the trace do not match the plan" << endl;
+        return 0;
+    }
+    t_start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < calls; ++r) { fov_plan.execute(xp, seeds, yp, J_plan); }
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_fov_plan = std::chrono::duration<double>(t_end - t_start).count() / calls;
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Gradients of the components with the scalar reverse mode at a fixed point
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // The weight vector selects a different component in every call
+    auto u = new double[m];
+    auto z_direct = new double[n];
+    auto z_plan = new double[n];
+    double checksum_direct = 0.00, checksum_plan = 0.00;
+
+    // zos_forward before every fos_reverse
+    t_start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < calls; ++r) {
+        for (int j = 0; j < m; ++j) { u[j] = (j == r % m) ? 1.00 : 0.00; }
+        zos_forward(tag, m, n, 1, xp, yp);
+        fos_reverse(tag, m, n, u, z_direct);
+        checksum_direct += z_direct[0] + z_direct[1];
+    }
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_rev_direct = std::chrono::duration<double>(t_end - t_start).count() / calls;
+
+    // Evaluation plan: the zos_forward sweep is only done for the first call
+    EvalPlan rev_plan(tag, FOS_REVERSE, m, n);
+    t_start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < calls; ++r) {
+        for (int j = 0; j < m; ++j) { u[j] = (j == r % m) ? 1.00 : 0.00; }
+        rev_plan.execute(xp, u, yp, z_plan);
+        checksum_plan += z_plan[0] + z_plan[1];
+    }
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_rev_plan = std::chrono::duration<double>(t_end - t_start).count() / calls;
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Print the results
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    double error = 0.00;
+    for (int k = 0; k < m*p; ++k) { error = fmax(error, fabs(J_direct[k] - J_plan[k])); }
+    error = fmax(error, fabs(checksum_direct - checksum_plan));
+
+    cout << "Time per call [us] (" << calls << " calls)" << endl;
+    cout << setw(20) << "Driver" << setw(20) << "Direct" << setw(20) << "Plan" << setw(20) << "zos sweeps (plan)" << endl;
+    cout.precision(3);
+    cout.setf(ios::fixed);
+    cout << setw(20) << "fov_forward" << setw(20) << time_fov_direct*1e6 << setw(20) << time_fov_plan*1e6
+         << setw(20) << 0 << endl;
+    cout << setw(20) << "fos_reverse" << setw(20) << time_rev_direct*1e6 << setw(20) << time_rev_plan*1e6
+         << setw(20) << rev_plan.forward_sweeps() << endl;
+    cout << endl;
+    cout << "The maximum difference between the results is " << error << endl;
+    cout << endl << endl;
+
+
+
+    /* Observations:
+     *
+     *  For a small trace the allocation and filling of the driver arrays is a significant part of each call
+     *  The reverse plan only repeats the zos_forward sweep when the point changes, which halves the work of the
+     *  reverse mode when several weight vectors are evaluated at the same point
+     *  The reverse plans assume that no other forward sweep with keep > 0 is done on the same tag between two calls and
+     *  that the trace is not retaped (create a new plan after retaping)
+     *
+     * */
+
+    return 0;
+
+
+}
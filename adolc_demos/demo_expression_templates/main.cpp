@@ -0,0 +1,312 @@
+// ------------------------------------------------------------------------------------------------------------------ //
+// Example showing how to evaluate traceless derivatives with expression templates to avoid temporary adoubles
+//
+// Every operator of adtl::adouble returns a new adouble with its own array of numDir derivatives, so a statement such
+// as f = R*cos(u)*cos(v) allocates, fills and frees one derivative array for each intermediate result. The expression
+// templates of this demo build the right-hand side as a small object of nested types instead. The value of each node
+// and the local partial derivatives are computed once when the expression is built, and the assignment evaluates the
+// derivative of the whole expression for one direction at a time:
+//
+//      df/dp = R*(cos(v)*(-sin(u)*du/dp) + cos(u)*(-sin(v)*dv/dp))       for p = 0, ..., numDir-1
+//
+// The loop over the directions reads the derivatives of the leaves and writes the derivatives of the result once, with
+// no intermediate derivative arrays and no memory allocation. The leaves are ordinary adtl::adouble variables wrapped
+// with et::var(), so the expression templates can be mixed with the traceless code of the other demos.
+//
+// ------------------------------------------------------------------------------------------------------------------ //
+
+
+// Include libraries
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <adolc/adtl.h>             // Header for traceless ADOL-C!
+
+
+// Define namespaces
+using namespace std;                // cout, endl
+using namespace std::chrono;        // nanoseconds, system_clock, seconds
+
+
+// Use special traceless namespace to define adoubles
+typedef adtl::adouble adouble;
+
+
+// Count the memory allocations of the program to compare both evaluations
+static size_t allocations = 0;
+
+void * operator new(size_t size) {
+    ++allocations;
+    if (void * p = malloc(size)) { return p; }
+    throw bad_alloc();
+}
+
+void operator delete(void * p) noexcept { free(p); }
+void operator delete(void * p, size_t) noexcept { free(p); }
+
+
+// Expression templates for traceless adoubles
+namespace et {
+
+    // Base class of all the expressions (static polymorphism)
+    template<typename E>
+    struct Expression {
+        const E & self() const { return static_cast<const E &>(*this); }
+    };
+
+    // Leaf of an expression: reference to a traceless adouble
+    struct Variable : Expression<Variable> {
+        explicit Variable(const adouble &x) : x(x), v(x.getValue()) {}
+        double value() const { return v; }
+        double derivative(size_t p) const { return x.getADValue(p); }
+        const adouble &x;
+        double v;
+    };
+
+    // Function of one expression with the local derivative dv (also used for the operations with a double)
+    template<typename A>
+    struct Unary : Expression<Unary<A>> {
+        Unary(const A &a, double v, double dv) : a(a), v(v), dv(dv) {}
+        double value() const { return v; }
+        double derivative(size_t p) const { return dv*a.derivative(p); }
+        A a;
+        double v, dv;
+    };
+
+    template<typename A, typename B>
+    struct Sum : Expression<Sum<A, B>> {
+        Sum(const A &a, const B &b) : a(a), b(b), v(a.value() + b.value()) {}
+        double value() const { return v; }
+        double derivative(size_t p) const { return a.derivative(p) + b.derivative(p); }
+        A a; B b;
+        double v;
+    };
+
+    template<typename A, typename B>
+    struct Difference : Expression<Difference<A, B>> {
+        Difference(const A &a, const B &b) : a(a), b(b), v(a.value() - b.value()) {}
+        double value() const { return v; }
+        double derivative(size_t p) const { return a.derivative(p) - b.derivative(p); }
+        A a; B b;
+        double v;
+    };
+
+    template<typename A, typename B>
+    struct Product : Expression<Product<A, B>> {
+        Product(const A &a, const B &b) : a(a), b(b), v(a.value()*b.value()) {}
+        double value() const { return v; }
+        double derivative(size_t p) const { return b.value()*a.derivative(p) + a.value()*b.derivative(p); }
+        A a; B b;
+        double v;
+    };
+
+    template<typename A, typename B>
+    struct Quotient : Expression<Quotient<A, B>> {
+        Quotient(const A &a, const B &b) : a(a), b(b), v(a.value()/b.value()), r(1.00/b.value()) {}
+        double value() const { return v; }
+        double derivative(size_t p) const { return r*(a.derivative(p) - v*b.derivative(p)); }
+        A a; B b;
+        double v, r;
+    };
+
+    inline Variable var(const adouble &x) { return Variable(x); }
+
+    // Operations between expressions
+    template<typename A, typename B>
+    Sum<A, B> operator+(const Expression<A> &a, const Expression<B> &b) { return Sum<A, B>(a.self(), b.self()); }
+
+    template<typename A, typename B>
+    Difference<A, B> operator-(const Expression<A> &a, const Expression<B> &b) { return Difference<A, B>(a.self(), b.self()); }
+
+    template<typename A, typename B>
+    Product<A, B> operator*(const Expression<A> &a, const Expression<B> &b) { return Product<A, B>(a.self(), b.self()); }
+
+    template<typename A, typename B>
+    Quotient<A, B> operator/(const Expression<A> &a, const Expression<B> &b) { return Quotient<A, B>(a.self(), b.self()); }
+
+    // Operations with a double
+    template<typename A>
+    Unary<A> operator+(const Expression<A> &a, double c) { return Unary<A>(a.self(), a.self().value() + c, 1.00); }
+
+    template<typename A>
+    Unary<A> operator+(double c, const Expression<A> &a) { return Unary<A>(a.self(), c + a.self().value(), 1.00); }
+
+    template<typename A>
+    Unary<A> operator-(const Expression<A> &a, double c) { return Unary<A>(a.self(), a.self().value() - c, 1.00); }
+
+    template<typename A>
+    Unary<A> operator-(double c, const Expression<A> &a) { return Unary<A>(a.self(), c - a.self().value(), -1.00); }
+
+    template<typename A>
+    Unary<A> operator-(const Expression<A> &a) { return Unary<A>(a.self(), -a.self().value(), -1.00); }
+
+    template<typename A>
+    Unary<A> operator*(const Expression<A> &a, double c) { return Unary<A>(a.self(), a.self().value()*c, c); }
+
+    template<typename A>
+    Unary<A> operator*(double c, const Expression<A> &a) { return Unary<A>(a.self(), c*a.self().value(), c); }
+
+    template<typename A>
+    Unary<A> operator/(const Expression<A> &a, double c) { return Unary<A>(a.self(), a.self().value()/c, 1.00/c); }
+
+    template<typename A>
+    Unary<A> operator/(double c, const Expression<A> &a) {
+        double v = c/a.self().value();
+        return Unary<A>(a.self(), v, -v/a.self().value());
+    }
+
+    // Elementary functions
+    template<typename A>
+    Unary<A> exp(const Expression<A> &a) {
+        double v = std::exp(a.self().value());
+        return Unary<A>(a.self(), v, v);
+    }
+
+    template<typename A>
+    Unary<A> log(const Expression<A> &a) { return Unary<A>(a.self(), std::log(a.self().value()), 1.00/a.self().value()); }
+
+    template<typename A>
+    Unary<A> sqrt(const Expression<A> &a) {
+        double v = std::sqrt(a.self().value());
+        return Unary<A>(a.self(), v, 0.50/v);
+    }
+
+    template<typename A>
+    Unary<A> sin(const Expression<A> &a) { return Unary<A>(a.self(), std::sin(a.self().value()), std::cos(a.self().value())); }
+
+    template<typename A>
+    Unary<A> cos(const Expression<A> &a) { return Unary<A>(a.self(), std::cos(a.self().value()), -std::sin(a.self().value())); }
+
+    // Assign an expression to a traceless adouble with one loop over the directions. The derivative of direction p only
+    // reads the direction p of the leaves, so the result can also appear on the right-hand side (y = y + x)
+    template<typename E>
+    void assign(adouble &y, const Expression<E> &e) {
+        const E &expression = e.self();
+        double v = expression.value();
+        size_t directions = adtl::getNumDir();
+        for (size_t p = 0; p < directions; ++p) { y.setADValue(p, expression.derivative(p)); }
+        y.setValue(v);
+    }
+
+}
+
+
+// Radius of the sphere
+static double R = 2.00;
+
+
+// Define the function to be differentiated: f_i(x) = R*cos(x_i)*cos(x_{i+1}) + exp((x_i + x_{i+1})/n)
+// Evaluation with the operators of adtl::adouble (one temporary adouble per operation)
+void my_function(const adouble * x, int n, adouble * f) {
+    for (int i = 0; i < n-1; ++i) {
+        f[i] = R*cos(x[i])*cos(x[i+1]) + exp((x[i] + x[i+1])/n);
+    }
+}
+
+// Evaluation with expression templates (one loop over the directions per statement)
+void my_function_et(const adouble * x, int n, adouble * f) {
+    using et::var;
+    for (int i = 0; i < n-1; ++i) {
+        et::assign(f[i], R*et::cos(var(x[i]))*et::cos(var(x[i+1])) + et::exp((var(x[i]) + var(x[i+1]))/n));
+    }
+}
+
+
+int main() {
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Initialize problem variables
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Set the desired number of independent variables (do it before declaring any adouble!)
+    const int n = 100, m = n - 1;
+    int repetitions = 1000;
+
+    // Prepare for traceless vector mode
+    adtl::setNumDir(n);
+
+    // Initialize active variables and seed the identity matrix (the Jacobian is computed in one evaluation)
+    auto x = new adouble[n];
+    auto f = new adouble[m];
+    auto f_et = new adouble[m];
+    for (int i = 0; i < n; ++i) {
+        x[i].setValue(0.50 + 0.01*i);
+        for (int j = 0; j < n; ++j) { x[i].setADValue(j, i == j ? 1.00 : 0.00); }
+    }
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Compute the Jacobian with both evaluations
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Operators of adtl::adouble
+    size_t allocations_start = allocations;
+    auto t_start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < repetitions; ++r) { my_function(x, n, f); }
+    auto t_end = std::chrono::high_resolution_clock::now();
+    double time_operators = std::chrono::duration<double>(t_end - t_start).count() / repetitions;
+    double allocations_operators = (double) (allocations - allocations_start) / repetitions / m;
+
+    // Expression templates
+    allocations_start = allocations;
+    t_start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < repetitions; ++r) { my_function_et(x, n, f_et); }
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_templates = std::chrono::duration<double>(t_end - t_start).count() / repetitions;
+    double allocations_templates = (double) (allocations - allocations_start) / repetitions / m;
+
+    // Compare the values and the Jacobians
+    double error = 0.00;
+    for (int i = 0; i < m; ++i) {
+        error = fmax(error, fabs(f[i].getValue() - f_et[i].getValue()));
+        for (int j = 0; j < n; ++j) { error = fmax(error, fabs(f[i].getADValue(j) - f_et[i].getADValue(j))); }
+    }
+
+    // Analytic derivative of the first component with respect to x_0
+    double x0 = x[0].getValue(), x1 = x[1].getValue();
+    double analytic = -R*sin(x0)*cos(x1) + exp((x0 + x1)/n)/n;
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Print the results
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    cout.precision(8);
+    cout.setf(ios::fixed);
+    cout << "Jacobian of f(x) with " << n << " directions in traceless vector mode" << endl;
+    cout << setw(25) << "Evaluation" << setw(20) << "Time [ms]" << setw(25) << "Allocations/statement" << endl;
+    cout << setw(25) << "adtl::adouble operators" << setw(20) << time_operators*1000 << setw(25) << allocations_operators << endl;
+    cout << setw(25) << "Expression templates" << setw(20) << time_templates*1000 << setw(25) << allocations_templates << endl;
+    cout << endl;
+    cout << "The maximum difference between both evaluations is " << error << endl;
+    cout << "df0/dx0: AD derivative " << f_et[0].getADValue(0) << ", analytic derivative " << analytic << endl;
+    cout << endl << endl;
+
+
+
+    /* Observations:
+     *
+     *  Each operator of adtl::adouble allocates the derivative array of its result, so the number of allocations per
+     *  statement grows with the number of operations in the statement. The expression templates do not allocate
+     *  The expression templates write the derivative array of the result once per statement and do not store any
+     *  intermediate derivatives, the speed-up grows with the number of directions
+     *  Both evaluations give the same values and derivatives up to round-off (the operations are grouped differently)
+     *  Only the statements written with et::var() and et::assign() benefit, the rest of the code still uses the
+     *  operators of adtl::adouble
+     *
+     * */
+
+    delete[] x;
+    delete[] f;
+    delete[] f_et;
+
+    return 0;
+
+
+}
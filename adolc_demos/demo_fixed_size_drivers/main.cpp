@@ -0,0 +1,259 @@
+// ------------------------------------------------------------------------------------------------------------------ //
+// Example showing how to evaluate many small Jacobians with drivers specialized for the problem size at compile time
+//
+// The drivers jacobian(tag, m, n, x, J) and gradient(tag, n, x, g) of ADOL-C take runtime dimensions, and the demos
+// allocate the input and output arrays with new or myalloc2() for every evaluation. For tiny functions that are
+// evaluated thousands of times (such as the element Jacobians of a finite element assembly) this overhead is
+// comparable to the cost of the sweeps.
+//
+// The drivers jacobian<M,N>(tag, x) and gradient<N>(tag, x) of this demo take the dimensions as template parameters
+// and return std::array results. The seed matrices and the row pointers needed by the ADOL-C sweeps are arrays on the
+// stack whose size is known at compile time, and the sweeps write directly into the rows of the result. The sweeps
+// themselves are still fov_forward() and fov_reverse() with runtime dimensions. As in jacobian(), the forward vector
+// mode is used when N/2 < M and the reverse vector mode otherwise, and the lowest return code of the sweeps is passed
+// back so that a branch switch of the trace (negative return code) is detected.
+//
+// ------------------------------------------------------------------------------------------------------------------ //
+
+
+// Include libraries
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <array>
+#include <adolc/adolc.h>
+
+
+// Define namespaces
+using namespace std;                // cout, endl
+using namespace std::chrono;        // nanoseconds, system_clock, seconds
+
+
+// Radius of the sphere
+static double R = 2.00;
+
+
+// Define the functions to be differentiated: sphere (m=3, n=2) as in demo_mimo_scalar and quadratic form (m=1, n=3)
+// as in demo_miso_scalar
+template<typename T>
+void my_function_mimo(const T * x, T * f) {
+    f[0] = R*cos(x[0])*cos(x[1]);
+    f[1] = R*sin(x[0])*cos(x[1]);
+    f[2] = R*sin(x[1]);
+}
+
+template<typename T>
+void my_function_miso(const T * x, T * f) {
+    f[0] = x[0]*x[0] + x[2]*x[2] + 2*x[0]*x[1] + x[2];
+}
+
+
+// Fixed-size matrix with M rows and N columns stored by rows
+template<int M, int N>
+using Matrix = array<array<double, N>, M>;
+
+
+// Jacobian of the trace tag (M dependent and N independent variables) at the point x. The return code of the sweeps
+// is stored in rc
+template<int M, int N>
+Matrix<M, N> jacobian(short tag, const array<double, N> &x, int &rc) {
+    Matrix<M, N> J;
+    double y[M];
+    if (N/2 < M) {
+        // Forward vector mode with the identity as seed matrix: the tangents are the rows of J
+        double seed[N][N];
+        double * S[N], * D[M];
+        for (int i = 0; i < N; ++i) {
+            for (int j = 0; j < N; ++j) { seed[i][j] = (i == j) ? 1.00 : 0.00; }
+            S[i] = seed[i];
+        }
+        for (int i = 0; i < M; ++i) { D[i] = J[i].data(); }
+        rc = fov_forward(tag, M, N, N, x.data(), S, y, D);
+    }
+    else {
+        // Reverse vector mode with the identity as weight matrix: the adjoints are the rows of J
+        double weight[M][M];
+        double * U[M], * Z[M];
+        for (int i = 0; i < M; ++i) {
+            for (int j = 0; j < M; ++j) { weight[i][j] = (i == j) ? 1.00 : 0.00; }
+            U[i] = weight[i];
+            Z[i] = J[i].data();
+        }
+        rc = zos_forward(tag, M, N, 1, x.data(), y);
+        if (rc >= 0) { rc = min(rc, fov_reverse(tag, M, N, M, U, Z)); }
+    }
+    return J;
+}
+
+
+// Gradient of the trace tag (one dependent and N independent variables) at the point x. The return code of the sweeps
+// is stored in rc
+template<int N>
+array<double, N> gradient(short tag, const array<double, N> &x, int &rc) {
+    array<double, N> g;
+    double y, one = 1.00;
+    rc = zos_forward(tag, 1, N, 1, x.data(), &y);
+    if (rc >= 0) { rc = min(rc, fos_reverse(tag, 1, N, &one, g.data())); }
+    return g;
+}
+
+
+// Trace the function f (m dependent and n independent variables) at the point xp
+void record(void (*f)(const adouble *, adouble *), short tag, int m, int n, const double * xp) {
+    auto x = new adouble[n];
+    auto y = new adouble[m];
+    auto yp = new double[m];
+    trace_on(tag);
+    for (int i = 0; i < n; ++i) { x[i] <<= xp[i]; }
+    f(x, y);
+    for (int i = 0; i < m; ++i) { y[i] >>= yp[i]; }
+    trace_off();
+    delete[] x;
+    delete[] y;
+    delete[] yp;
+}
+
+
+int main() {
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Initialize problem variables
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Number of elements (evaluation points) of the assembly
+    int elements = 100000;
+
+    // Trace both functions once
+    short tag_mimo = 0, tag_miso = 1;
+    double x0[3] = {0.50, 0.25, 1.00};
+    record(my_function_mimo<adouble>, tag_mimo, 3, 2, x0);
+    record(my_function_miso<adouble>, tag_miso, 1, 3, x0);
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Jacobians of the sphere (m=3, n=2) at all the elements
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Runtime driver allocating the arrays of each element (as in demo_mimo_scalar)
+    double sum_runtime = 0.00;
+    auto t_start = std::chrono::high_resolution_clock::now();
+    for (int e = 0; e < elements; ++e) {
+        auto xp = new double[2];
+        xp[0] = 0.50 + 1e-5*e;
+        xp[1] = 0.25 - 1e-5*e;
+        auto J = myalloc2(3, 2);
+        jacobian(tag_mimo, 3, 2, xp, J);
+        sum_runtime += J[0][0] + J[1][1] + J[2][1];
+        myfree2(J);
+        delete[] xp;
+    }
+    auto t_end = std::chrono::high_resolution_clock::now();
+    double time_runtime = std::chrono::duration<double>(t_end - t_start).count();
+
+    // Runtime driver with the arrays allocated once
+    double sum_preallocated = 0.00;
+    double xp[2];
+    auto J = myalloc2(3, 2);
+    t_start = std::chrono::high_resolution_clock::now();
+    for (int e = 0; e < elements; ++e) {
+        xp[0] = 0.50 + 1e-5*e;
+        xp[1] = 0.25 - 1e-5*e;
+        jacobian(tag_mimo, 3, 2, xp, J);
+        sum_preallocated += J[0][0] + J[1][1] + J[2][1];
+    }
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_preallocated = std::chrono::duration<double>(t_end - t_start).count();
+    myfree2(J);
+
+    // Fixed-size driver (keeping the lowest return code of all the elements)
+    double sum_fixed = 0.00;
+    int rc, rc_fixed = 3;
+    t_start = std::chrono::high_resolution_clock::now();
+    for (int e = 0; e < elements; ++e) {
+        array<double, 2> x = {0.50 + 1e-5*e, 0.25 - 1e-5*e};
+        Matrix<3, 2> Jf = jacobian<3, 2>(tag_mimo, x, rc);
+        rc_fixed = min(rc_fixed, rc);
+        sum_fixed += Jf[0][0] + Jf[1][1] + Jf[2][1];
+    }
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_fixed = std::chrono::duration<double>(t_end - t_start).count();
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Gradients of the quadratic form (m=1, n=3) at all the elements
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Runtime driver allocating the arrays of each element (as in demo_miso_scalar)
+    double sum_gradient_runtime = 0.00;
+    t_start = std::chrono::high_resolution_clock::now();
+    for (int e = 0; e < elements; ++e) {
+        auto xq = new double[3];
+        auto g = new double[3];
+        xq[0] = 1.00 + 1e-5*e; xq[1] = 1.00; xq[2] = 1.00 - 1e-5*e;
+        gradient(tag_miso, 3, xq, g);
+        sum_gradient_runtime += g[0] + g[1] + g[2];
+        delete[] xq;
+        delete[] g;
+    }
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_gradient_runtime = std::chrono::duration<double>(t_end - t_start).count();
+
+    // Fixed-size driver
+    double sum_gradient_fixed = 0.00;
+    t_start = std::chrono::high_resolution_clock::now();
+    for (int e = 0; e < elements; ++e) {
+        array<double, 3> x = {1.00 + 1e-5*e, 1.00, 1.00 - 1e-5*e};
+        array<double, 3> g = gradient<3>(tag_miso, x, rc);
+        rc_fixed = min(rc_fixed, rc);
+        sum_gradient_fixed += g[0] + g[1] + g[2];
+    }
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_gradient_fixed = std::chrono::duration<double>(t_end - t_start).count();
+
+    // Jacobian of the quadratic form with the fixed-size driver (reverse mode because N/2 >= M) at (1, 1, 1)
+    Matrix<1, 3> Jq = jacobian<1, 3>(tag_miso, {1.00, 1.00, 1.00}, rc);
+    rc_fixed = min(rc_fixed, rc);
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Print the results
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    cout.precision(8);
+    cout.setf(ios::fixed);
+    cout << "Derivatives at " << elements << " elements" << endl;
+    cout << setw(30) << "Driver" << setw(20) << "Time [ms]" << setw(25) << "Sum of entries" << endl;
+    cout << setw(30) << "jacobian() allocating" << setw(20) << time_runtime*1000 << setw(25) << sum_runtime << endl;
+    cout << setw(30) << "jacobian() preallocated" << setw(20) << time_preallocated*1000 << setw(25) << sum_preallocated << endl;
+    cout << setw(30) << "jacobian<3,2>()" << setw(20) << time_fixed*1000 << setw(25) << sum_fixed << endl;
+    cout << setw(30) << "gradient() allocating" << setw(20) << time_gradient_runtime*1000 << setw(25) << sum_gradient_runtime << endl;
+    cout << setw(30) << "gradient<3>()" << setw(20) << time_gradient_fixed*1000 << setw(25) << sum_gradient_fixed << endl;
+    cout << endl;
+    cout << "Jacobian of the quadratic form at (1, 1, 1): [" << Jq[0][0] << ", " << Jq[0][1] << ", " << Jq[0][2] << "]";
+    cout << " (analytic derivative [4, 2, 3])" << endl;
+    cout << "Lowest return code of the fixed-size drivers: " << rc_fixed;
+    cout << (rc_fixed < 0 ? " (branch switch, the trace must be recorded again at the new point)" : "") << endl;
+    cout << endl << endl;
+
+
+
+    /* Observations:
+     *
+     *  The fixed-size drivers call the same ADOL-C sweeps as jacobian() and gradient(), so the results are identical.
+     *  The difference in time comes from the allocations of each element and from the work of the runtime drivers
+     *  around the sweeps (allocation and initialization of the seed matrix in jacobian())
+     *  Most of the time of each evaluation is still spent in the sweeps of the trace, which do not depend on how the
+     *  driver was called
+     *  The results are returned by value, the compiler constructs them directly in the variable of the caller
+     *
+     * */
+
+    return 0;
+
+
+}
@@ -0,0 +1,461 @@
+// ------------------------------------------------------------------------------------------------------------------ //
+// Example showing how the numbering of the locations affects the memory footprint of the vector forward sweep
+//
+// ADOL-C assigns a location to every adouble when it is created and keeps it until the adouble is destroyed. The
+// demos allocate the intermediate variables up front with new adouble[n], so the locations follow the creation order
+// of the variables and all of them are live during the whole trace. The forward sweeps need p Taylor coefficients for
+// every live location, so the size of the Taylor buffer grows with the number of locations and not with the number of
+// values that are actually needed at the same time.
+//
+// This demo records the function into a small expression graph and renumbers the results of the operations with a
+// linear scan, as done in register allocation: the location of a result is released after its last use and the next
+// result takes the lowest free location, which keeps the operands of consecutive operations close to each other.
+// A hand-written fov sweep over the graph is timed with one location per operation and with the renumbered locations.
+// The graph is also written to an ADOL-C trace releasing each adouble after its last use and compared with the trace
+// recorded directly from the code with preallocated arrays.
+//
+// ------------------------------------------------------------------------------------------------------------------ //
+
+
+// Include libraries
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <queue>
+#include <functional>
+#include <adolc/adolc.h>
+
+
+// Define namespaces
+using namespace std;                // cout, endl
+using namespace std::chrono;        // nanoseconds, system_clock, seconds
+
+
+// Operations of the expression graph (the constant operand of the _D_ operations is stored in the node)
+enum Opcode {CONSTANT, INDEPENDENT, PLUS_A_A, MULT_A_A, PLUS_D_A, MULT_D_A, EXP, SIN};
+
+struct Node {
+    Opcode op;
+    int arg1, arg2;
+    double constant;
+    double value;
+};
+
+
+// Expression graph recorded between begin() and end(), analogous to an ADOL-C trace
+class Graph {
+
+public:
+
+    vector<Node> nodes;
+    vector<int> independents, dependents;
+
+    void begin() { nodes.clear(); independents.clear(); dependents.clear(); active = this; }
+    void end() { active = nullptr; }
+
+    static int add(Opcode op, int arg1, int arg2, double constant, double value) {
+        active->nodes.push_back({op, arg1, arg2, constant, value});
+        return (int) active->nodes.size() - 1;
+    }
+
+    static Graph * active;
+
+};
+
+Graph * Graph::active = nullptr;
+
+
+// Active variable of the expression graph: each operation evaluates its value and appends a node to the active graph
+class Var {
+
+public:
+
+    Var() : id(-1) {}
+    Var(double c) : id(Graph::add(CONSTANT, -1, -1, c, c)) {}
+
+    double value() const { return Graph::active->nodes[node()].value; }
+
+    Var & operator<<=(double x) {
+        id = Graph::add(INDEPENDENT, -1, -1, 0.00, x);
+        Graph::active->independents.push_back(id);
+        return *this;
+    }
+
+    Var & operator>>=(double &y) {
+        Graph::active->dependents.push_back(node());
+        y = value();
+        return *this;
+    }
+
+    Var & operator+=(const Var &b) { return *this = *this + b; }
+    Var & operator*=(const Var &b) { return *this = *this * b; }
+
+    friend Var operator+(const Var &a, const Var &b) { return make(PLUS_A_A, a, b, 0.00, a.value() + b.value()); }
+    friend Var operator*(const Var &a, const Var &b) { return make(MULT_A_A, a, b, 0.00, a.value() * b.value()); }
+
+    // Mixed operations are mapped to the same operations that ADOL-C records (a - c as a + (-c), a / c as (1/c) * a)
+    friend Var operator+(double c, const Var &a) { return make(PLUS_D_A, a, a, c, c + a.value()); }
+    friend Var operator+(const Var &a, double c) { return c + a; }
+    friend Var operator-(const Var &a, double c) { return (-c) + a; }
+    friend Var operator*(double c, const Var &a) { return make(MULT_D_A, a, a, c, c * a.value()); }
+    friend Var operator*(const Var &a, double c) { return c * a; }
+    friend Var operator/(const Var &a, double c) { return (1.00/c) * a; }
+
+    friend Var exp(const Var &a) { return make(EXP, a, a, 0.00, exp(a.value())); }
+    friend Var sin(const Var &a) { return make(SIN, a, a, 0.00, sin(a.value())); }
+
+private:
+
+    // Node of the variable. A default-constructed variable is zero and records its constant only when it is read, so
+    // the variables that are assigned before they are read (such as the independent variables) do not leave a node
+    int node() const {
+        if (id < 0) { id = Graph::add(CONSTANT, -1, -1, 0.00, 0.00); }
+        return id;
+    }
+
+    static Var make(Opcode op, const Var &a, const Var &b, double constant, double value) {
+        Var result;
+        result.id = Graph::add(op, a.node(), b.node(), constant, value);
+        return result;
+    }
+
+    mutable int id;
+
+};
+
+
+// Index of the last operation that uses the result of each operation (the dependents are used at the end)
+vector<int> last_uses(const Graph &graph) {
+    int size = (int) graph.nodes.size();
+    vector<int> last_use(size, -1);
+    for (int k = 0; k < size; ++k) {
+        const Node &node = graph.nodes[k];
+        if (node.arg1 >= 0) { last_use[node.arg1] = last_use[node.arg2] = k; }
+    }
+    for (int d : graph.dependents) { last_use[d] = size; }
+    return last_use;
+}
+
+
+// One location per operation, in creation order (what the trace looks like without releasing any variable)
+int creation_order(const Graph &graph, vector<int> &location) {
+    location.resize(graph.nodes.size());
+    for (size_t k = 0; k < location.size(); ++k) { location[k] = (int) k; }
+    return (int) location.size();
+}
+
+
+// Linear scan: release the locations of the operands at their last use and give each result the lowest free location
+int linear_scan(const Graph &graph, vector<int> &location) {
+    vector<int> last_use = last_uses(graph);
+    location.resize(graph.nodes.size());
+    priority_queue<int, vector<int>, greater<int>> free_locations;
+    int num_locations = 0;
+    for (int k = 0; k < (int) graph.nodes.size(); ++k) {
+        const Node &node = graph.nodes[k];
+        if (node.arg1 >= 0 && last_use[node.arg1] == k) { free_locations.push(location[node.arg1]); }
+        if (node.arg2 >= 0 && node.arg2 != node.arg1 && last_use[node.arg2] == k) {
+            free_locations.push(location[node.arg2]);
+        }
+        if (free_locations.empty()) {
+            location[k] = num_locations++;
+        } else {
+            location[k] = free_locations.top();
+            free_locations.pop();
+        }
+        if (last_use[k] < k) { free_locations.push(location[k]); }     // Result that is never used
+    }
+    return num_locations;
+}
+
+
+// Vector forward sweep over the graph with the given numbering. The value and the p tangents of a location are read
+// before the result is written, so a result can take the location of one of its operands
+void fov_sweep(const Graph &graph, const vector<int> &location, int p, const double * xp, double ** X, double * yp,
+               double ** Y, double * value, double * tangent) {
+    int i = 0;
+    for (size_t k = 0; k < graph.nodes.size(); ++k) {
+        const Node &node = graph.nodes[k];
+        double * y = tangent + (size_t) location[k]*p;
+        if (node.op == CONSTANT) {
+            value[location[k]] = node.constant;
+            for (int dir = 0; dir < p; ++dir) { y[dir] = 0.00; }
+            continue;
+        }
+        if (node.op == INDEPENDENT) {
+            value[location[k]] = xp[i];
+            for (int dir = 0; dir < p; ++dir) { y[dir] = X[i][dir]; }
+            ++i;
+            continue;
+        }
+        const double va = value[location[node.arg1]], vb = value[location[node.arg2]], c = node.constant;
+        const double * a = tangent + (size_t) location[node.arg1]*p;
+        const double * b = tangent + (size_t) location[node.arg2]*p;
+        switch (node.op) {
+            case PLUS_A_A:
+                for (int dir = 0; dir < p; ++dir) { y[dir] = a[dir] + b[dir]; }
+                value[location[k]] = va + vb;
+                break;
+            case MULT_A_A:
+                for (int dir = 0; dir < p; ++dir) { y[dir] = va*b[dir] + vb*a[dir]; }
+                value[location[k]] = va*vb;
+                break;
+            case PLUS_D_A:
+                for (int dir = 0; dir < p; ++dir) { y[dir] = a[dir]; }
+                value[location[k]] = c + va;
+                break;
+            case MULT_D_A:
+                for (int dir = 0; dir < p; ++dir) { y[dir] = c*a[dir]; }
+                value[location[k]] = c*va;
+                break;
+            case EXP: {
+                double e = exp(va);
+                for (int dir = 0; dir < p; ++dir) { y[dir] = e*a[dir]; }
+                value[location[k]] = e;
+                break;
+            }
+            case SIN: {
+                double s = sin(va), d = cos(va);
+                for (int dir = 0; dir < p; ++dir) { y[dir] = d*a[dir]; }
+                value[location[k]] = s;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    for (size_t j = 0; j < graph.dependents.size(); ++j) {
+        int loc = location[graph.dependents[j]];
+        yp[j] = value[loc];
+        for (int dir = 0; dir < p; ++dir) { Y[j][dir] = tangent[(size_t) loc*p + dir]; }
+    }
+}
+
+
+// Backward liveness pass: an operation is live if its result reaches a dependent variable
+vector<bool> live_operations(const Graph &graph) {
+    vector<bool> live(graph.nodes.size(), false);
+    for (int d : graph.dependents) { live[d] = true; }
+    for (int k = (int) graph.nodes.size() - 1; k >= 0; --k) {
+        const Node &node = graph.nodes[k];
+        if (!live[k] || node.arg1 < 0) { continue; }
+        live[node.arg1] = true;
+        live[node.arg2] = true;
+    }
+    return live;
+}
+
+
+// Write the graph to an ADOL-C trace releasing the adouble of each result after its last use. The operations that do
+// not reach a dependent are not written, the independent variables are always declared to keep their numbering
+void replay(const Graph &graph, short tag, double * yp) {
+    int size = (int) graph.nodes.size();
+    vector<int> last_use = last_uses(graph);
+    vector<bool> live = live_operations(graph);
+    vector<adouble *> a(size, nullptr);
+    auto release = [&](int arg, int k) {
+        if (arg >= 0 && a[arg] != nullptr && last_use[arg] <= k) { delete a[arg]; a[arg] = nullptr; }
+    };
+    trace_on(tag);
+    for (int k = 0; k < size; ++k) {
+        const Node &node = graph.nodes[k];
+        const double c = node.constant;
+        if (live[k] || node.op == INDEPENDENT) {
+            switch (node.op) {
+                case CONSTANT:    a[k] = new adouble(c); break;
+                case INDEPENDENT: a[k] = new adouble; *a[k] <<= node.value; break;
+                case PLUS_A_A:    a[k] = new adouble(*a[node.arg1] + *a[node.arg2]); break;
+                case MULT_A_A:    a[k] = new adouble(*a[node.arg1] * *a[node.arg2]); break;
+                case PLUS_D_A:    a[k] = new adouble(c + *a[node.arg1]); break;
+                case MULT_D_A:    a[k] = new adouble(c * *a[node.arg1]); break;
+                case EXP:         a[k] = new adouble(exp(*a[node.arg1])); break;
+                case SIN:         a[k] = new adouble(sin(*a[node.arg1])); break;
+            }
+        }
+        release(node.arg1, k);
+        release(node.arg2, k);
+        release(k, k);
+    }
+    for (size_t i = 0; i < graph.dependents.size(); ++i) { *a[graph.dependents[i]] >>= yp[i]; }
+    trace_off();
+    for (adouble * p : a) { delete p; }
+}
+
+
+// Define the function to be differentiated: f(x) = e^[(sin(x0)*x0 + ... + sin(xn)*xn)/n]
+// The intermediate variables are allocated up front, as in the other demos
+template<typename T>
+T my_function(T * x, int n) {
+    auto s = new T[n];
+    auto t = new T[n];
+    T sum = 0;
+    for (int i = 0; i < n; ++i) {
+        s[i] = sin(x[i]);
+        t[i] = s[i]*x[i];
+        sum += t[i];
+    }
+    T f = exp(sum/n);
+    delete[] s;
+    delete[] t;
+    return f;
+};
+
+
+int main() {
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Initialize problem variables
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Initialize passive variables
+    int m = 1, n = 100000;      // Set n equal to the desired number of independent variables
+    auto xp = new double[n];    // Independent vector
+    auto yp = new double[m];    // Dependent vector
+
+    // Set the value of the independent variables
+    for (int i = 0; i < n; ++i) {
+        xp[i] = 1.00 + 0.10*(i % 7);
+    }
+
+    // Number of directions of the vector mode and seed matrix
+    int p = 10, repetitions = 10;
+    double **X = myalloc2(n, p);
+    for (int i = 0; i < n; ++i) {
+        for (int dir = 0; dir < p; ++dir) { X[i][dir] = (i % p == dir) ? 1.00 : 0.00; }
+    }
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Active section for automatic differentiation (direct trace with the preallocated arrays)
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Initialize active variables
+    auto x = new adouble[n];
+    auto y = new adouble[m];
+
+    // Start tracing floating point operations
+    trace_on(0);    // Start of the active section
+
+    // Assign independent variables
+    for (int i = 0; i < n; ++i) {
+        x[i] <<= xp[i];
+    }
+
+    // Evaluate the body of the differentiated code
+    y[0] = my_function(x, n);
+
+    // Assign dependent variables
+    y[0] >>= yp[0];
+
+    trace_off();    // End of the active section
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Record the expression graph and renumber the locations
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    Graph graph;
+    graph.begin();
+    auto xv = new Var[n];
+    for (int i = 0; i < n; ++i) {
+        xv[i] <<= xp[i];
+    }
+    Var yv = my_function(xv, n);
+    yv >>= yp[0];
+    graph.end();
+
+    vector<int> location[2];
+    int num_locations[2];
+    num_locations[0] = creation_order(graph, location[0]);
+    auto t_start = std::chrono::high_resolution_clock::now();
+    num_locations[1] = linear_scan(graph, location[1]);
+    auto t_end = std::chrono::high_resolution_clock::now();
+    double time_scan = std::chrono::duration<double>(t_end - t_start).count();
+
+    // Time the hand-written fov sweep with both numberings
+    double **Y[2], time[2];
+    for (int k = 0; k < 2; ++k) {
+        auto value = new double[num_locations[k]];
+        auto tangent = new double[(size_t) num_locations[k]*p];
+        Y[k] = myalloc2(m, p);
+        t_start = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < repetitions; ++r) { fov_sweep(graph, location[k], p, xp, X, yp, Y[k], value, tangent); }
+        t_end = std::chrono::high_resolution_clock::now();
+        time[k] = std::chrono::duration<double>(t_end - t_start).count() / repetitions;
+        delete[] value;
+        delete[] tangent;
+    }
+
+    // Write the graph to an ADOL-C trace releasing the variables after their last use
+    replay(graph, 1, yp);
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Compare the ADOL-C traces
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    size_t counts[2][STAT_SIZE];
+    double **Y_adolc[2], time_adolc[2];
+    for (int tag = 0; tag < 2; ++tag) {
+        tapestats(tag, counts[tag]);
+        Y_adolc[tag] = myalloc2(m, p);
+        t_start = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < repetitions; ++r) { fov_forward(tag, m, n, p, xp, X, yp, Y_adolc[tag]); }
+        t_end = std::chrono::high_resolution_clock::now();
+        time_adolc[tag] = std::chrono::duration<double>(t_end - t_start).count() / repetitions;
+    }
+
+    double error = 0.00;
+    for (int dir = 0; dir < p; ++dir) {
+        error = fmax(error, fabs(Y[0][0][dir] - Y_adolc[0][0][dir]));
+        error = fmax(error, fabs(Y[1][0][dir] - Y_adolc[0][0][dir]));
+        error = fmax(error, fabs(Y_adolc[1][0][dir] - Y_adolc[0][0][dir]));
+    }
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Print the results
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    cout << "Hand-written fov sweep over the graph (p = " << p << ", linear scan in " << time_scan*1000
+         << " milliseconds)" << endl;
+    cout << setw(20) << "Numbering" << setw(20) << "Locations" << setw(20) << "Taylor [MB]" << setw(20) << "fov [ms]" << endl;
+    cout << setw(20) << "Creation order" << setw(20) << num_locations[0]
+         << setw(20) << num_locations[0]*(p + 1)*8.00/(1 << 20) << setw(20) << time[0]*1000 << endl;
+    cout << setw(20) << "Linear scan" << setw(20) << num_locations[1]
+         << setw(20) << num_locations[1]*(p + 1)*8.00/(1 << 20) << setw(20) << time[1]*1000 << endl;
+    cout << endl;
+
+    cout << "ADOL-C fov_forward (p = " << p << ")" << endl;
+    cout << setw(20) << "Trace" << setw(20) << "Max live locs" << setw(20) << "Operations" << setw(20) << "fov [ms]" << endl;
+    cout << setw(20) << "Direct" << setw(20) << counts[0][NUM_MAX_LIVES] << setw(20) << counts[0][NUM_OPERATIONS]
+         << setw(20) << time_adolc[0]*1000 << endl;
+    cout << setw(20) << "Released" << setw(20) << counts[1][NUM_MAX_LIVES] << setw(20) << counts[1][NUM_OPERATIONS]
+         << setw(20) << time_adolc[1]*1000 << endl;
+    cout << endl;
+    cout << "The maximum difference between the tangents is " << error << endl;
+    cout << endl << endl;
+
+
+
+    /* Observations:
+     *
+     *  With one location per operation the Taylor buffer grows with the length of the trace
+     *  The linear scan only needs the independent variables plus a few temporaries, the buffer is much smaller and the
+     *  operands of consecutive operations are close to each other in memory
+     *  Releasing the intermediate variables after their last use has the same effect on the ADOL-C trace. Prefer
+     *  local adoubles that go out of scope over arrays allocated up front
+     *
+     * */
+
+    return 0;
+
+
+}
@@ -0,0 +1,446 @@
+// ------------------------------------------------------------------------------------------------------------------ //
+// Example showing how to store the trace of a loop as one body and a trip count instead of one copy per iteration
+//
+// The loops of the demos (the delay loop x = x + 0*j or the iterations of a solver) are unrolled by the taping: every
+// iteration appends the same operations to the trace, so the trace grows with the number of iterations although the
+// body is always the same. This demo does two things:
+//
+//  1. It records the function into a small expression graph and detects the repeated segment. Node k+P of the segment
+//     matches node k when it has the same operation and constant, and each argument either is shifted by the period
+//     P (the value of the previous iteration) or is the same node before the loop (a loop invariant). The graph is
+//     then stored as prologue + body + trip count + epilogue, and a zero-order forward sweep iterates over the body
+//     with the results of the last two iterations in a ring of 2P locations, so both the trace and the memory of the
+//     sweep are O(body).
+//
+//  2. The reverse sweep needs the values of all the iterations, which is the problem solved by the checkpointing
+//     facility of ADOL-C: the loop body is traced once as a time step on its own tag and the main trace only stores
+//     a checkpointing operation with the number of steps (CP_Context). The reverse sweep recomputes the values from a
+//     few checkpoints with the revolve algorithm. The size of the trace and the cost of the gradient are compared with
+//     the fully unrolled trace.
+//
+// The loop of this demo is the Newton iteration for the square root x = 0.5*(x + a/x), whose derivative with respect
+// to a is known.
+//
+// ------------------------------------------------------------------------------------------------------------------ //
+
+
+// Include libraries
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <adolc/adolc.h>
+#include <adolc/checkpointing.h>
+
+
+// Define namespaces
+using namespace std;                // cout, endl
+using namespace std::chrono;        // nanoseconds, system_clock, seconds
+
+
+// Operations of the expression graph (the constant operand of the _D_ operations is stored in the node)
+enum Opcode {CONSTANT, INDEPENDENT, PLUS_A_A, MULT_A_A, DIV_A_A, PLUS_D_A, MULT_D_A, EXP};
+
+struct Node {
+    Opcode op;
+    int arg1, arg2;
+    double constant;
+    double value;
+};
+
+
+// Expression graph recorded between begin() and end(), analogous to an ADOL-C trace
+class Graph {
+
+public:
+
+    vector<Node> nodes;
+    vector<int> independents, dependents;
+
+    void begin() { nodes.clear(); independents.clear(); dependents.clear(); active = this; }
+    void end() { active = nullptr; }
+
+    static int add(Opcode op, int arg1, int arg2, double constant, double value) {
+        active->nodes.push_back({op, arg1, arg2, constant, value});
+        return (int) active->nodes.size() - 1;
+    }
+
+    static Graph * active;
+
+};
+
+Graph * Graph::active = nullptr;
+
+
+// Active variable of the expression graph: each operation evaluates its value and appends a node to the active graph
+class Var {
+
+public:
+
+    Var() : id(-1) {}
+    Var(double c) : id(Graph::add(CONSTANT, -1, -1, c, c)) {}
+
+    double value() const { return Graph::active->nodes[node()].value; }
+
+    Var & operator<<=(double x) {
+        id = Graph::add(INDEPENDENT, -1, -1, 0.00, x);
+        Graph::active->independents.push_back(id);
+        return *this;
+    }
+
+    Var & operator>>=(double &y) {
+        Graph::active->dependents.push_back(node());
+        y = value();
+        return *this;
+    }
+
+    Var & operator+=(const Var &b) { return *this = *this + b; }
+    Var & operator*=(const Var &b) { return *this = *this * b; }
+    Var & operator/=(const Var &b) { return *this = *this / b; }
+
+    friend Var operator+(const Var &a, const Var &b) { return make(PLUS_A_A, a, b, 0.00, a.value() + b.value()); }
+    friend Var operator*(const Var &a, const Var &b) { return make(MULT_A_A, a, b, 0.00, a.value() * b.value()); }
+    friend Var operator/(const Var &a, const Var &b) { return make(DIV_A_A, a, b, 0.00, a.value() / b.value()); }
+
+    // Mixed operations are mapped to the same operations that ADOL-C records (a - c as a + (-c), a / c as (1/c) * a)
+    friend Var operator+(double c, const Var &a) { return make(PLUS_D_A, a, a, c, c + a.value()); }
+    friend Var operator+(const Var &a, double c) { return c + a; }
+    friend Var operator-(const Var &a, double c) { return (-c) + a; }
+    friend Var operator*(double c, const Var &a) { return make(MULT_D_A, a, a, c, c * a.value()); }
+    friend Var operator*(const Var &a, double c) { return c * a; }
+    friend Var operator/(const Var &a, double c) { return (1.00/c) * a; }
+
+    friend Var exp(const Var &a) { return make(EXP, a, a, 0.00, exp(a.value())); }
+
+private:
+
+    // Node of the variable. A default-constructed variable is zero and records its constant only when it is read, so
+    // the variables that are assigned before they are read (such as the independent variables) do not leave a node
+    int node() const {
+        if (id < 0) { id = Graph::add(CONSTANT, -1, -1, 0.00, 0.00); }
+        return id;
+    }
+
+    static Var make(Opcode op, const Var &a, const Var &b, double constant, double value) {
+        Var result;
+        result.id = Graph::add(op, a.node(), b.node(), constant, value);
+        return result;
+    }
+
+    mutable int id;
+
+};
+
+
+// Graph stored as prologue [0, start), body [start, start + period) repeated trips times and epilogue
+struct RolledGraph {
+    vector<Node> prologue, body, epilogue;
+    vector<unsigned char> shifts;       // Bit i set when the argument i of the body node is shifted every iteration
+    int start = 0, period = 0, trips = 1;
+    size_t unrolled_size = 0;
+    vector<int> independents, dependents;
+    size_t size() const { return prologue.size() + body.size() + epilogue.size(); }
+};
+
+
+// Number of nodes from node start + period on that repeat node k - period (same operation and constant, arguments
+// shifted by the period or equal to a node before start). An argument of the first iteration may be shifted from a
+// node before start, this is the initial value of a variable carried by the loop
+size_t repeated_length(const Graph &graph, int start, int period) {
+    size_t size = graph.nodes.size(), k = start + period;
+    for (; k < size; ++k) {
+        const Node &a = graph.nodes[k - period], &b = graph.nodes[k];
+        if (a.op != b.op || a.constant != b.constant) { break; }
+        if (a.op == CONSTANT || a.op == INDEPENDENT) { break; }
+        int args_a[2] = {a.arg1, a.arg2}, args_b[2] = {b.arg1, b.arg2};
+        bool match = true;
+        for (int i = 0; i < 2; ++i) {
+            bool shifted = args_b[i] == args_a[i] + period && args_b[i] >= start;
+            bool invariant = args_b[i] == args_a[i] && args_a[i] < start;
+            match = match && (shifted || invariant);
+        }
+        if (!match) { break; }
+    }
+    return k - (start + period);
+}
+
+
+// Detect the repeated segment that covers the most nodes (prologues and periods up to max_search nodes) and store the
+// graph with the segment rolled. Every argument must be one of the last 2*period results, so that the forward sweeps
+// can keep the results of the body in a ring of 2*period locations. The search stops at the first segment that repeats
+// until the end of the graph, otherwise every candidate start and period would scan the whole loop again
+RolledGraph roll(const Graph &graph, int max_search) {
+
+    int size = (int) graph.nodes.size();
+    int best_start = 0, best_period = 0, best_trips = 1;
+    bool covered = false;
+    for (int start = 0; start < min(max_search, size) && !covered; ++start) {
+        for (int period = 1; period <= max_search && start + 2*period <= size && !covered; ++period) {
+            int trips = 1 + (int) repeated_length(graph, start, period) / period;
+            if (trips > 1 && (long) trips*period > (long) best_trips*best_period) {
+                best_start = start; best_period = period; best_trips = trips;
+                covered = size - (start + trips*period) < period;     // No room left for another iteration
+            }
+        }
+    }
+
+    RolledGraph rolled;
+    rolled.unrolled_size = graph.nodes.size();
+    rolled.independents = graph.independents;
+    rolled.dependents = graph.dependents;
+    if (best_trips == 1) {
+        rolled.prologue = graph.nodes;
+        return rolled;
+    }
+
+    // Check the distance of the arguments of the body and of the epilogue
+    int end = best_start + best_trips*best_period;
+    for (int k = best_start; k < size; ++k) {
+        const Node &node = graph.nodes[k];
+        if (node.op == CONSTANT || node.op == INDEPENDENT) { continue; }
+        int reference = min(k, end);
+        for (int arg : {node.arg1, node.arg2}) {
+            int distance = reference - arg + (k < end ? 1 : 0);
+            if (arg >= best_start && arg < end && distance > 2*best_period) {
+                rolled.prologue = graph.nodes;
+                return rolled;
+            }
+        }
+    }
+
+    rolled.start = best_start;
+    rolled.period = best_period;
+    rolled.trips = best_trips;
+    rolled.prologue.assign(graph.nodes.begin(), graph.nodes.begin() + best_start);
+    rolled.body.assign(graph.nodes.begin() + best_start, graph.nodes.begin() + best_start + best_period);
+    rolled.epilogue.assign(graph.nodes.begin() + end, graph.nodes.end());
+    for (int i = 0; i < best_period; ++i) {
+        const Node &a = graph.nodes[best_start + i], &b = graph.nodes[best_start + best_period + i];
+        rolled.shifts.push_back((a.arg1 != b.arg1 ? 1 : 0) | (a.arg2 != b.arg2 ? 2 : 0));
+    }
+    return rolled;
+
+}
+
+
+// Zero-order forward sweep over the rolled graph. The node k of the unrolled graph is stored in the location
+// loc(k): prologue nodes in [0, start), body results in a ring of 2*period locations and epilogue nodes after it
+struct RolledSweep {
+
+    const RolledGraph &g;
+    int end;
+
+    explicit RolledSweep(const RolledGraph &g) : g(g), end(g.start + g.trips*g.period) {}
+
+    int loc(int k) const {
+        if (k < g.start || g.trips == 1) { return k; }
+        if (k < end) { return g.start + (k - g.start) % (2*g.period); }
+        return g.start + 2*g.period + (k - end);
+    }
+
+    size_t locations() const { return g.trips == 1 ? g.prologue.size() : g.start + 2*g.period + g.epilogue.size(); }
+
+    void zos(const double * x, double * v) const {
+        int independent = 0;
+        auto evaluate = [&](const Node &N, int k) {
+            double &r = v[loc(k)];
+            switch (N.op) {
+                case CONSTANT:    r = N.constant; break;
+                case INDEPENDENT: r = x[independent++]; break;
+                case PLUS_A_A:    r = v[loc(N.arg1)] + v[loc(N.arg2)]; break;
+                case MULT_A_A:    r = v[loc(N.arg1)] * v[loc(N.arg2)]; break;
+                case DIV_A_A:     r = v[loc(N.arg1)] / v[loc(N.arg2)]; break;
+                case PLUS_D_A:    r = v[loc(N.arg1)] + N.constant; break;
+                case MULT_D_A:    r = N.constant * v[loc(N.arg1)]; break;
+                case EXP:         r = exp(v[loc(N.arg1)]); break;
+            }
+        };
+        int k = 0;
+        for (const Node &N : g.prologue) { evaluate(N, k++); }
+        for (int t = 0; t < g.trips && !g.body.empty(); ++t) {
+            for (int i = 0; i < g.period; ++i) {
+                // Shift the arguments of the body to iteration t
+                Node N = g.body[i];
+                if (g.shifts[i] & 1) { N.arg1 += t*g.period; }
+                if (g.shifts[i] & 2) { N.arg2 += t*g.period; }
+                evaluate(N, k++);
+            }
+        }
+        for (const Node &N : g.epilogue) { evaluate(N, k++); }
+    }
+
+};
+
+
+// Define the function to be differentiated: Newton iteration for the square root of a
+template<typename T>
+T my_function(const T &a, int iterations) {
+    T x = a + 0.00;
+    for (int j = 0; j < iterations; ++j) {
+        x = 0.50*(x + a/x);
+    }
+    return x;
+}
+
+
+// Time step of the Newton iteration for the checkpointing facility of ADOL-C. The state is [x, a]
+int newton_step(int n, adouble * state) {
+    (void) n;
+    state[0] = 0.50*(state[0] + state[1]/state[0]);
+    return 0;
+}
+
+int newton_step_double(int n, double * state) {
+    (void) n;
+    state[0] = 0.50*(state[0] + state[1]/state[0]);
+    return 0;
+}
+
+
+int main() {
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Initialize problem variables
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Number of iterations, number of checkpoints and value of a
+    int iterations = 1000000, checkpoints = 100;
+    double ap = 2.00, yp;
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Detect and roll the loop of the expression graph
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    Graph graph;
+    graph.begin();
+    Var ag;
+    ag <<= ap;
+    Var yg = my_function(ag, iterations);
+    yg >>= yp;
+    graph.end();
+
+    RolledGraph rolled = roll(graph, 16);
+    RolledSweep sweep(rolled);
+    vector<double> v(sweep.locations());
+    sweep.zos(&ap, v.data());
+    double y_rolled = v[sweep.loc(graph.dependents[0])];
+
+    cout.precision(8);
+    cout.setf(ios::fixed);
+    cout << "Loop rolling of the expression graph" << endl;
+    cout << setw(30) << "Unrolled nodes" << setw(20) << rolled.unrolled_size << endl;
+    cout << setw(30) << "Prologue nodes" << setw(20) << rolled.prologue.size() << endl;
+    cout << setw(30) << "Body nodes" << setw(20) << rolled.body.size() << endl;
+    cout << setw(30) << "Trip count" << setw(20) << rolled.trips << endl;
+    cout << setw(30) << "Epilogue nodes" << setw(20) << rolled.epilogue.size() << endl;
+    cout << setw(30) << "Locations of the sweep" << setw(20) << sweep.locations() << endl;
+    cout << setw(30) << "Value (unrolled)" << setw(20) << yp << endl;
+    cout << setw(30) << "Value (rolled)" << setw(20) << y_rolled << endl;
+    cout << endl << endl;
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Active section for automatic differentiation (unrolled trace and checkpointed trace)
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Set the tags for the Automatic Differentiation traces
+    short tag_unrolled = 0, tag_checkpointed = 1, tag_step = 2;
+
+    // Unrolled trace: every iteration is recorded
+    auto t_start = std::chrono::high_resolution_clock::now();
+    {
+        adouble a, y;
+        trace_on(tag_unrolled);
+        a <<= ap;
+        y = my_function(a, iterations);
+        y >>= yp;
+        trace_off();
+    }
+    auto t_end = std::chrono::high_resolution_clock::now();
+    double time_tape_unrolled = std::chrono::duration<double>(t_end - t_start).count();
+
+    // Checkpointed trace: the body is recorded once on tag_step and the main trace stores the number of steps
+    t_start = std::chrono::high_resolution_clock::now();
+    {
+        adouble a, y, state[2];
+        trace_on(tag_checkpointed);
+        a <<= ap;
+        state[0] = a;
+        state[1] = a;
+        CP_Context cpc(newton_step);
+        cpc.setDoubleFct(newton_step_double);
+        cpc.setNumberOfSteps(iterations);
+        cpc.setNumberOfCheckpoints(checkpoints);
+        cpc.setTapeNumber(tag_step);
+        cpc.setDimensionXY(2);
+        cpc.setInput(state);
+        cpc.setOutput(state);
+        cpc.setAlwaysRetaping(false);
+        cpc.checkpointing();
+        y = state[0];
+        y >>= yp;
+        trace_off();
+    }
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_tape_checkpointed = std::chrono::duration<double>(t_end - t_start).count();
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Compare the size of the traces and the gradients
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    size_t stats_unrolled[STAT_SIZE], stats_checkpointed[STAT_SIZE], stats_step[STAT_SIZE];
+    tapestats(tag_unrolled, stats_unrolled);
+    tapestats(tag_checkpointed, stats_checkpointed);
+    tapestats(tag_step, stats_step);
+
+    double g_unrolled, g_checkpointed;
+    t_start = std::chrono::high_resolution_clock::now();
+    gradient(tag_unrolled, 1, &ap, &g_unrolled);
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_unrolled = std::chrono::duration<double>(t_end - t_start).count();
+
+    t_start = std::chrono::high_resolution_clock::now();
+    gradient(tag_checkpointed, 1, &ap, &g_checkpointed);
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_checkpointed = std::chrono::duration<double>(t_end - t_start).count();
+
+    cout << "ADOL-C traces of " << iterations << " iterations" << endl;
+    cout << setw(20) << "Trace" << setw(20) << "Operations" << setw(20) << "Taping [ms]" << setw(20) << "Gradient [ms]"
+         << setw(20) << "dy/da" << endl;
+    cout << setw(20) << "Unrolled" << setw(20) << stats_unrolled[NUM_OPERATIONS] << setw(20) << time_tape_unrolled*1000
+         << setw(20) << time_unrolled*1000 << setw(20) << g_unrolled << endl;
+    cout << setw(20) << "Checkpointed" << setw(20) << stats_checkpointed[NUM_OPERATIONS] + stats_step[NUM_OPERATIONS]
+         << setw(20) << time_tape_checkpointed*1000 << setw(20) << time_checkpointed*1000 << setw(20) << g_checkpointed
+         << endl;
+    cout << "Analytic derivative: " << 0.50/sqrt(ap) << endl;
+    cout << endl << endl;
+
+
+
+    /* Observations:
+     *
+     *  The body of the Newton iteration has three nodes (a/x, x + a/x and the product by 0.5), the argument a is a loop
+     *  invariant and x is shifted by one period. The rolled graph stores five nodes (the prologue with a and x0 and
+     *  the body) and the trip count instead of three million nodes, and the sweep uses 2 + 2*3 = 8 locations (see the
+     *  output above)
+     *  The delay loop x = x + 0*j of the other demos has a body of one node whose argument is shifted by one period, it
+     *  is rolled in the same way. A body whose constants change with the iteration is not repeated and is not rolled
+     *  The forward sweep of the rolled graph only needs the results of the last two iterations. The reverse sweep needs
+     *  the values of all the iterations, the checkpointing facility recomputes them from the checkpoints so the size of
+     *  the checkpointed traces does not depend on the number of iterations
+     *  The checkpointed gradient is slower than the unrolled one because of the recomputations of revolve, it trades
+     *  time for memory
+     *
+     * */
+
+    return 0;
+
+
+}
@@ -0,0 +1,498 @@
+// ------------------------------------------------------------------------------------------------------------------ //
+// Example comparing double, mixed and single precision buffers for first order derivative sweeps
+//
+// ADOL-C stores the values, Taylor coefficients and adjoints of the trace in double precision. When only a screening
+// gradient is needed, the same sweeps can be evaluated with single precision (float) buffers, which halves the memory
+// traffic and doubles the number of SIMD lanes. The reductions (the sum in my_function) are the only operations that
+// need more precision, so they are accumulated in double. This demo records my_function into a small expression graph
+// and implements generic zos_forward, fos_forward, fov_forward and fos_reverse sweeps over its operations for a given
+// storage type and accumulation type. The values, tangents and adjoints of every operation are stored in the storage
+// type, while the running value of a chain of additions (a sum accumulated in a loop) is kept in the accumulation type
+// and only rounded when it is stored. The accuracy and the computational time of three combinations are compared
+// against the ADOL-C drivers:
+//
+//  - double storage and double accumulation (same precision as ADOL-C)
+//  - float storage and double accumulation (mixed precision)
+//  - float storage and float accumulation (single precision)
+//
+// ------------------------------------------------------------------------------------------------------------------ //
+
+
+// Include libraries
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <utility>
+#include <adolc/adolc.h>
+
+
+// Define namespaces
+using namespace std;                // cout, endl
+using namespace std::chrono;        // nanoseconds, system_clock, seconds
+
+
+// Operations of the expression graph (the constant operand of the _D_ operations is stored in the node)
+enum Opcode {CONSTANT, INDEPENDENT, PLUS_A_A, MULT_D_A, EXP};
+
+struct Node {
+    Opcode op;
+    int arg1, arg2;
+    double constant;
+    double value;
+};
+
+
+// Expression graph recorded between begin() and end(), analogous to an ADOL-C trace
+class Graph {
+
+public:
+
+    vector<Node> nodes;
+    vector<int> independents, dependents;
+
+    void begin() { nodes.clear(); independents.clear(); dependents.clear(); active = this; }
+    void end() { active = nullptr; }
+
+    static int add(Opcode op, int arg1, int arg2, double constant, double value) {
+        active->nodes.push_back({op, arg1, arg2, constant, value});
+        return (int) active->nodes.size() - 1;
+    }
+
+    static Graph * active;
+
+};
+
+Graph * Graph::active = nullptr;
+
+
+// Active variable of the expression graph: each operation evaluates its value and appends a node to the active graph
+class Var {
+
+public:
+
+    Var() : id(-1) {}
+    Var(double c) : id(Graph::add(CONSTANT, -1, -1, c, c)) {}
+
+    double value() const { return Graph::active->nodes[node()].value; }
+
+    Var & operator<<=(double x) {
+        id = Graph::add(INDEPENDENT, -1, -1, 0.00, x);
+        Graph::active->independents.push_back(id);
+        return *this;
+    }
+
+    Var & operator>>=(double &y) {
+        Graph::active->dependents.push_back(node());
+        y = value();
+        return *this;
+    }
+
+    Var & operator+=(const Var &b) { return *this = *this + b; }
+
+    friend Var operator+(const Var &a, const Var &b) { return make(PLUS_A_A, a, b, 0.00, a.value() + b.value()); }
+
+    // Mixed operations are mapped to the same operations that ADOL-C records (a - c as a + (-c), a / c as (1/c) * a)
+    friend Var operator*(double c, const Var &a) { return make(MULT_D_A, a, a, c, c * a.value()); }
+    friend Var operator*(const Var &a, double c) { return c * a; }
+    friend Var operator/(const Var &a, double c) { return (1.00/c) * a; }
+
+    friend Var exp(const Var &a) { return make(EXP, a, a, 0.00, exp(a.value())); }
+
+private:
+
+    // Node of the variable. A default-constructed variable is zero and records its constant only when it is read, so
+    // the variables that are assigned before they are read (such as the independent variables) do not leave a node
+    int node() const {
+        if (id < 0) { id = Graph::add(CONSTANT, -1, -1, 0.00, 0.00); }
+        return id;
+    }
+
+    static Var make(Opcode op, const Var &a, const Var &b, double constant, double value) {
+        Var result;
+        result.id = Graph::add(op, a.node(), b.node(), constant, value);
+        return result;
+    }
+
+    mutable int id;
+
+};
+
+
+// Define the function to be differentiated: f(x) = e^[(x0+x1+...+xn)/n]
+template<typename T>
+T my_function(T * x, int n) {
+    T sum;
+    for (int i = 0; i < n; ++i) {
+        sum += x[i];
+    }
+    T f = exp(sum/n);
+    return f;
+};
+
+
+// The sweeps store the result of node k in location k. An addition whose argument is the result of the previous
+// addition continues a chain: its running value is kept in a register of type Accum and only the stored copy is
+// rounded to Real, so a sum over many variables is accumulated in Accum even if every value is stored as Real
+template<typename Accum>
+struct Chain {
+    int node = -1;              // Node whose exact value is in the register
+    Accum value = 0;
+    // Arguments of an addition ordered so that the first one is the end of the chain (if any of them is)
+    pair<int, int> arguments(const Node &node) const {
+        return (node.arg2 == this->node) ? make_pair(node.arg2, node.arg1) : make_pair(node.arg1, node.arg2);
+    }
+};
+
+
+// Zero-order forward sweep: values of the nodes in v
+template<typename Real, typename Accum>
+void zos_sweep(const Graph &graph, const Real * x, Real * v, Real &y) {
+    Chain<Accum> chain;
+    int i = 0;
+    for (int k = 0; k < (int) graph.nodes.size(); ++k) {
+        const Node &node = graph.nodes[k];
+        switch (node.op) {
+            case CONSTANT:    v[k] = (Real) node.constant; break;
+            case INDEPENDENT: v[k] = x[i++]; break;
+            case PLUS_A_A: {
+                auto args = chain.arguments(node);
+                if (args.first != chain.node) { chain.value = (Accum) v[args.first]; }
+                chain.value += (Accum) v[args.second];
+                chain.node = k;
+                v[k] = (Real) chain.value;
+                break;
+            }
+            case MULT_D_A:    v[k] = (Real) node.constant*v[node.arg1]; break;
+            case EXP:         v[k] = exp(v[node.arg1]); break;
+        }
+    }
+    y = v[graph.dependents[0]];
+}
+
+
+// First-order forward sweep in scalar mode: values in v and tangents in v1
+template<typename Real, typename Accum>
+void fos_sweep(const Graph &graph, const Real * x, const Real * x1, Real * v, Real * v1, Real &y, Real &y1) {
+    Chain<Accum> chain;
+    Accum chain1 = 0;           // Tangent of the chain
+    int i = 0;
+    for (int k = 0; k < (int) graph.nodes.size(); ++k) {
+        const Node &node = graph.nodes[k];
+        switch (node.op) {
+            case CONSTANT:    v[k] = (Real) node.constant; v1[k] = 0; break;
+            case INDEPENDENT: v[k] = x[i]; v1[k] = x1[i]; ++i; break;
+            case PLUS_A_A: {
+                auto args = chain.arguments(node);
+                if (args.first != chain.node) {
+                    chain.value = (Accum) v[args.first];
+                    chain1 = (Accum) v1[args.first];
+                }
+                chain.value += (Accum) v[args.second];
+                chain1 += (Accum) v1[args.second];
+                chain.node = k;
+                v[k] = (Real) chain.value;
+                v1[k] = (Real) chain1;
+                break;
+            }
+            case MULT_D_A:
+                v[k] = (Real) node.constant*v[node.arg1];
+                v1[k] = (Real) node.constant*v1[node.arg1];
+                break;
+            case EXP:
+                v[k] = exp(v[node.arg1]);
+                v1[k] = v[k]*v1[node.arg1];
+                break;
+        }
+    }
+    y = v[graph.dependents[0]];
+    y1 = v1[graph.dependents[0]];
+}
+
+
+// First-order forward sweep in vector mode: the p tangents of node k are contiguous in V[k*p + dir]. The tangents of
+// the chain are kept in work (p entries of type Accum)
+template<typename Real, typename Accum>
+void fov_sweep(const Graph &graph, int p, const Real * x, const Real * X, Real * v, Real * V, Real &y, Real * Y,
+               Accum * work) {
+    Chain<Accum> chain;
+    int i = 0;
+    for (int k = 0; k < (int) graph.nodes.size(); ++k) {
+        const Node &node = graph.nodes[k];
+        Real * t = V + (size_t) k*p;
+        const Real * a = V + (size_t) node.arg1*p;
+        switch (node.op) {
+            case CONSTANT:
+                v[k] = (Real) node.constant;
+                for (int dir = 0; dir < p; ++dir) { t[dir] = 0; }
+                break;
+            case INDEPENDENT:
+                v[k] = x[i];
+                for (int dir = 0; dir < p; ++dir) { t[dir] = X[(size_t) i*p + dir]; }
+                ++i;
+                break;
+            case PLUS_A_A: {
+                auto args = chain.arguments(node);
+                const Real * first = V + (size_t) args.first*p, * second = V + (size_t) args.second*p;
+                if (args.first != chain.node) {
+                    chain.value = (Accum) v[args.first];
+                    for (int dir = 0; dir < p; ++dir) { work[dir] = (Accum) first[dir]; }
+                }
+                chain.value += (Accum) v[args.second];
+                for (int dir = 0; dir < p; ++dir) { work[dir] += (Accum) second[dir]; }
+                chain.node = k;
+                v[k] = (Real) chain.value;
+                for (int dir = 0; dir < p; ++dir) { t[dir] = (Real) work[dir]; }
+                break;
+            }
+            case MULT_D_A:
+                v[k] = (Real) node.constant*v[node.arg1];
+                for (int dir = 0; dir < p; ++dir) { t[dir] = (Real) node.constant*a[dir]; }
+                break;
+            case EXP:
+                v[k] = exp(v[node.arg1]);
+                for (int dir = 0; dir < p; ++dir) { t[dir] = v[k]*a[dir]; }
+                break;
+        }
+    }
+    y = v[graph.dependents[0]];
+    for (int dir = 0; dir < p; ++dir) { Y[dir] = V[(size_t) graph.dependents[0]*p + dir]; }
+}
+
+
+// First-order reverse sweep in scalar mode with the values v of a previous zos_sweep. The adjoints are stored in vbar
+// and every increment of an adjoint is added in the accumulation type
+template<typename Real, typename Accum>
+void fos_reverse_sweep(const Graph &graph, const Real * v, Real u, Real * vbar, Real * z) {
+    int size = (int) graph.nodes.size();
+    for (int k = 0; k < size; ++k) { vbar[k] = 0; }
+    vbar[graph.dependents[0]] = u;
+    auto increment = [&](int j, Real w) { vbar[j] = (Real) ((Accum) vbar[j] + (Accum) w); };
+    int i = (int) graph.independents.size();
+    for (int k = size - 1; k >= 0; --k) {
+        const Node &node = graph.nodes[k];
+        switch (node.op) {
+            case CONSTANT:    break;
+            case INDEPENDENT: z[--i] = vbar[k]; break;
+            case PLUS_A_A:    increment(node.arg1, vbar[k]); increment(node.arg2, vbar[k]); break;
+            case MULT_D_A:    increment(node.arg1, (Real) node.constant*vbar[k]); break;
+            case EXP:         increment(node.arg1, v[k]*vbar[k]); break;
+        }
+    }
+}
+
+
+// Maximum relative error of an array with respect to a reference array
+template<typename Real>
+double max_relative_error(int size, const Real * a, const double * reference) {
+    double error = 0.00;
+    for (int i = 0; i < size; ++i) {
+        error = fmax(error, fabs(a[i] - reference[i]) / fabs(reference[i]));
+    }
+    return error;
+}
+
+
+// Convert an array of doubles to the storage type of the sweeps
+template<typename Real>
+Real * convert(int size, const double * a) {
+    auto b = new Real[size];
+    for (int i = 0; i < size; ++i) { b[i] = (Real) a[i]; }
+    return b;
+}
+
+
+// Time the three sweeps with the given storage and accumulation types and print their errors
+template<typename Real, typename Accum>
+void benchmark(const char * label, const Graph &graph, int n, int p, int repetitions, const double * xp,
+               const double * x1, double ** X, const double * y1_ref, const double * Y_ref, const double * z_ref) {
+
+    // Convert the inputs to the storage type (the buffers are allocated once, outside the timed region)
+    size_t size = graph.nodes.size();
+    Real * x = convert<Real>(n, xp);
+    Real * xd = convert<Real>(n, x1);
+    Real * XX = new Real[(size_t) n*p];
+    for (int i = 0; i < n; ++i) {
+        for (int dir = 0; dir < p; ++dir) { XX[(size_t) i*p + dir] = (Real) X[i][dir]; }
+    }
+    Real * v = new Real[size], * v1 = new Real[size], * V = new Real[size*p], * vbar = new Real[size];
+    Real y = 0, y1 = 0, *Y = new Real[p], *z = new Real[n];
+    Accum * work = new Accum[p];
+
+    // Forward scalar mode
+    auto t_start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < repetitions; ++r) { fos_sweep<Real, Accum>(graph, x, xd, v, v1, y, y1); }
+    auto t_end = std::chrono::high_resolution_clock::now();
+    double time_fos = std::chrono::duration<double>(t_end - t_start).count() / repetitions;
+
+    // Forward vector mode
+    t_start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < repetitions; ++r) { fov_sweep<Real, Accum>(graph, p, x, XX, v, V, y, Y, work); }
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_fov = std::chrono::duration<double>(t_end - t_start).count() / repetitions;
+
+    // Reverse scalar mode (including the forward sweep that prepares it, as for the ADOL-C driver)
+    t_start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < repetitions; ++r) {
+        zos_sweep<Real, Accum>(graph, x, v, y);
+        fos_reverse_sweep<Real, Accum>(graph, v, (Real) 1.00, vbar, z);
+    }
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_rev = std::chrono::duration<double>(t_end - t_start).count() / repetitions;
+
+    // Print the results
+    cout << setw(30) << label
+         << setw(14) << time_fos*1000 << setw(14) << max_relative_error(1, &y1, y1_ref)
+         << setw(14) << time_fov*1000 << setw(14) << max_relative_error(p, Y, Y_ref)
+         << setw(14) << time_rev*1000 << setw(14) << max_relative_error(n, z, z_ref) << endl;
+
+    delete[] x; delete[] xd; delete[] XX; delete[] v; delete[] v1; delete[] V; delete[] vbar;
+    delete[] Y; delete[] z; delete[] work;
+
+}
+
+
+int main() {
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Initialize problem variables
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Initialize passive variables
+    int m = 1, n = 1000000;     // Large number of independent variables to make the sweeps memory-bound
+    auto xp = new double[n];    // Independent vector
+    auto yp = new double[m];    // Dependent vector
+
+    // Set the value of the independent variables (not exactly representable in single precision)
+    for (int i = 0; i < n; ++i) {
+        xp[i] = 1.00 + 0.10*(i % 7);
+    }
+
+    // Initialize active variables
+    auto x = new adouble[n];
+    auto y = new adouble[m];
+
+    // Define the number of directions of the vector mode and the number of repetitions of each sweep
+    int p = 8, repetitions = 10;
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Active section for automatic differentiation
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Set the tag for the Automatic Differentiation trace
+    int tag = 0;
+
+    // Start tracing floating point operations
+    trace_on(tag);  // Start of the active section
+
+    // Assign independent variables
+    for (int i = 0; i < n; ++i) {
+        x[i] <<= xp[i];
+    }
+
+    // Evaluate the body of the differentiated code (no artificial delay, we want to compare the sweeps)
+    y[0] = my_function(x, n);
+
+    // Assign dependent variables
+    y[0] >>= yp[0];
+
+    trace_off();    // End of the active section
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Compute the reference derivatives with the ADOL-C drivers (double precision)
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Tangent vector of the scalar mode and tangent directions of the vector mode
+    auto x1 = new double[n];
+    double **X = myalloc(n, p);
+    for (int i = 0; i < n; ++i) {
+        x1[i] = 0.10*(i % 10);
+        for (int dir = 0; dir < p; ++dir) {
+            X[i][dir] = 0.10*((i + dir) % 10);
+        }
+    }
+
+    // Forward scalar mode
+    auto y1 = new double[m];
+    auto t_start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < repetitions; ++r) { fos_forward(tag, m, n, 0, xp, x1, yp, y1); }
+    auto t_end = std::chrono::high_resolution_clock::now();
+    double time_fos = std::chrono::duration<double>(t_end - t_start).count() / repetitions;
+
+    // Forward vector mode
+    double **Y = myalloc(m, p);
+    t_start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < repetitions; ++r) { fov_forward(tag, m, n, p, xp, X, yp, Y); }
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_fov = std::chrono::duration<double>(t_end - t_start).count() / repetitions;
+
+    // Reverse scalar mode (including the forward sweep that prepares it)
+    auto u = new double[m];
+    auto z = new double[n];
+    u[0] = 1.00;
+    t_start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < repetitions; ++r) {
+        zos_forward(tag, m, n, 1, xp, yp);
+        fos_reverse(tag, m, n, u, z);
+    }
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_rev = std::chrono::duration<double>(t_end - t_start).count() / repetitions;
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Record the expression graph and compare the accuracy and computational time of the storage and accumulation types
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    Graph graph;
+    graph.begin();
+    auto xv = new Var[n];
+    for (int i = 0; i < n; ++i) {
+        xv[i] <<= xp[i];
+    }
+    Var yv = my_function(xv, n);
+    double y_graph;
+    yv >>= y_graph;
+    graph.end();
+    delete[] xv;
+
+    cout << "Time per sweep [ms] and maximum relative error with respect to the ADOL-C drivers (n = " << n
+         << ", p = " << p << ")" << endl;
+    cout << setw(30) << "Storage / accumulation"
+         << setw(14) << "fos_forward" << setw(14) << "error"
+         << setw(14) << "fov_forward" << setw(14) << "error"
+         << setw(14) << "fos_reverse" << setw(14) << "error" << endl;
+    cout.precision(4);
+    cout.setf(ios::scientific);
+    cout << setw(30) << "ADOL-C (double / double)"
+         << setw(14) << time_fos*1000 << setw(14) << 0.00
+         << setw(14) << time_fov*1000 << setw(14) << 0.00
+         << setw(14) << time_rev*1000 << setw(14) << 0.00 << endl;
+    benchmark<double, double>("double / double", graph, n, p, repetitions, xp, x1, X, y1, Y[0], z);
+    benchmark<float, double>("float / double", graph, n, p, repetitions, xp, x1, X, y1, Y[0], z);
+    benchmark<float, float>("float / float", graph, n, p, repetitions, xp, x1, X, y1, Y[0], z);
+    cout << endl << endl;
+
+
+
+    /* Observations:
+     *
+     *  The float / double combination keeps the relative error close to the single precision round-off (~1e-7)
+     *  The float / float combination loses several digits because the rounding errors of the long sums accumulate
+     *  The float storage reduces the time of the memory-bound sweeps (fov_forward reads n*p tangent values)
+     *  The sweeps over the graph are generic in the storage and accumulation types, so the comparison between the three
+     *  variants shows the effect of the precision alone. They interpret the graph as ADOL-C interprets its trace, but
+     *  only implement the operations of my_function
+     *
+     * */
+
+    return 0;
+
+
+}
@@ -0,0 +1,279 @@
+// ------------------------------------------------------------------------------------------------------------------ //
+// Example showing how to evaluate the derivatives of a model-predictive-control horizon from a single stage trace
+//
+// The dynamics constraints of a horizon with N stages are c_k = F(x_k, u_k) - x_{k+1} for k = 0, ..., N-1, where F
+// is the discretized dynamics of one stage. All the stages use the same function F, so the stage is traced once and
+// the Jacobian [A_k B_k] of each stage is evaluated with jacobian() at the state and control of the stage. The stages
+// are independent of each other and they are evaluated in parallel threads when ADOL-C was built with OpenMP support:
+// each thread receives a copy of the stage trace through the ADOLC_OpenMP_Handler (see adolc_openmp.h).
+//
+// The Jacobian of the horizon is block-banded: each block row k only has the blocks A_k and B_k (computed) and -I
+// (constant). It is stored as N dense blocks of nx x (nx+nu) instead of a dense matrix of N*nx x N*(nx+nu)+nx, and
+// it provides the matrix-vector product needed by the KKT solver.
+//
+// The stage dynamics are those of a cart-pole system discretized with one step of the Runge-Kutta method of order 4
+//
+// ------------------------------------------------------------------------------------------------------------------ //
+
+
+// Include libraries
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <adolc/adolc.h>
+#ifdef ADOLC_WITH_OPENMP
+#include <omp.h>
+#include <adolc/adolc_openmp.h>
+#endif
+
+
+// Define namespaces
+using namespace std;                // cout, endl
+using namespace std::chrono;        // nanoseconds, system_clock, seconds
+
+
+// Dimensions of the stage: states (position, angle, velocity, angular velocity) and controls (force)
+const int NX = 4, NU = 1;
+
+// Parameters of the cart-pole system and time step
+static double mc = 1.00, mp = 0.10, l = 0.50, g = 9.81, dt = 0.02;
+
+
+// Continuous dynamics of the cart-pole system: xdot = f(x, u)
+template<typename T>
+void dynamics(const T * x, const T &u, T * xdot) {
+    T s = sin(x[1]), c = cos(x[1]);
+    T denominator = mc + mp*s*s;
+    xdot[0] = x[2];
+    xdot[1] = x[3];
+    xdot[2] = (u + mp*s*(l*x[3]*x[3] + g*c)) / denominator;
+    xdot[3] = (-u*c - mp*l*x[3]*x[3]*c*s - (mc + mp)*g*s) / (l*denominator);
+}
+
+
+// Define the function to be differentiated: one stage x_next = F(x, u) with the Runge-Kutta method of order 4
+// The input is z = [x, u]
+template<typename T>
+void my_function(const T * z, T * x_next) {
+    T k1[NX], k2[NX], k3[NX], k4[NX], xs[NX];
+    dynamics(z, z[NX], k1);
+    for (int i = 0; i < NX; ++i) { xs[i] = z[i] + 0.50*dt*k1[i]; }
+    dynamics(xs, z[NX], k2);
+    for (int i = 0; i < NX; ++i) { xs[i] = z[i] + 0.50*dt*k2[i]; }
+    dynamics(xs, z[NX], k3);
+    for (int i = 0; i < NX; ++i) { xs[i] = z[i] + dt*k3[i]; }
+    dynamics(xs, z[NX], k4);
+    for (int i = 0; i < NX; ++i) { x_next[i] = z[i] + dt/6.00*(k1[i] + 2.00*k2[i] + 2.00*k3[i] + k4[i]); }
+}
+
+
+// Jacobian of the dynamics constraints of the horizon with respect to w = [x_0, u_0, x_1, u_1, ..., x_{N-1}, u_{N-1},
+// x_N]. Block row k is [A_k B_k -I] at the columns of (x_k, u_k, x_{k+1}), only the blocks [A_k B_k] are stored
+class HorizonJacobian {
+
+public:
+
+    HorizonJacobian(int N) : N(N), blocks((size_t) N*NX*(NX + NU)), rows((size_t) N*NX) {
+        for (size_t r = 0; r < rows.size(); ++r) { rows[r] = &blocks[r*(NX + NU)]; }
+    }
+
+    int stages() const { return N; }
+
+    // Row pointers of the block of stage k (the layout expected by jacobian())
+    double ** block(int k) { return &rows[(size_t) k*NX]; }
+    const double * const * block(int k) const { return &rows[(size_t) k*NX]; }
+
+    // Product with a vector of the horizon variables: c_k = A_k*x_k + B_k*u_k - x_{k+1}
+    void multiply(const double * w, double * c) const {
+        for (int k = 0; k < N; ++k) {
+            const double * const * J = block(k);
+            const double * z = w + k*(NX + NU);
+            for (int i = 0; i < NX; ++i) {
+                double s = -z[NX + NU + i];
+                for (int j = 0; j < NX + NU; ++j) { s += J[i][j]*z[j]; }
+                c[k*NX + i] = s;
+            }
+        }
+    }
+
+    // Number of stored entries and size of the equivalent dense matrix
+    size_t stored() const { return blocks.size(); }
+    size_t dense() const { return (size_t) N*NX*((size_t) N*(NX + NU) + NX); }
+
+private:
+
+    int N;
+    vector<double> blocks;
+    vector<double *> rows;
+
+};
+
+
+// Dynamics constraints of the horizon: c_k = F(x_k, u_k) - x_{k+1}
+void constraints(int N, const double * w, double * c) {
+    for (int k = 0; k < N; ++k) {
+        double x_next[NX];
+        my_function(w + k*(NX + NU), x_next);
+        for (int i = 0; i < NX; ++i) { c[k*NX + i] = x_next[i] - w[(k+1)*(NX + NU) + i]; }
+    }
+}
+
+
+// Evaluate the Jacobians of all the stages of the horizon from the stage trace. Z holds the N points z_k = [x_k, u_k]
+void horizon_jacobian(short tag, int N, const double * Z, HorizonJacobian &J, int threads) {
+#ifdef ADOLC_WITH_OPENMP
+    #pragma omp parallel num_threads(threads) firstprivate(ADOLC_OpenMP_Handler)
+    {
+        #pragma omp for schedule(static)
+        for (int k = 0; k < N; ++k) { jacobian(tag, NX, NX + NU, Z + k*(NX + NU), J.block(k)); }
+    }
+#else
+    (void) threads;
+    for (int k = 0; k < N; ++k) { jacobian(tag, NX, NX + NU, Z + k*(NX + NU), J.block(k)); }
+#endif
+}
+
+
+int main() {
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Initialize problem variables
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Horizon length and number of evaluations of the horizon derivatives
+    int N = 50, repetitions = 1000;
+    int n = NX + NU, m = NX;
+
+    // Trajectory of the horizon: simulate the system with a given control sequence
+    vector<double> Z((size_t) N*n), W((size_t) N*n + NX);
+    double x0[NX] = {0.00, 0.20, 0.00, 0.00};
+    for (int i = 0; i < NX; ++i) { Z[i] = x0[i]; }
+    for (int k = 0; k < N; ++k) {
+        Z[k*n + NX] = 0.50*sin(0.10*k);
+        double x_next[NX];
+        my_function(&Z[k*n], x_next);
+        for (int i = 0; i < NX; ++i) {
+            if (k + 1 < N) { Z[(k+1)*n + i] = x_next[i]; }
+            else { W[(size_t) N*n + i] = x_next[i]; }
+        }
+    }
+    for (size_t i = 0; i < Z.size(); ++i) { W[i] = Z[i]; }
+
+    // Initialize active variables
+    auto z = new adouble[n];
+    auto y = new adouble[m];
+    auto yp = new double[m];
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Active section for automatic differentiation (one stage)
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Set the tag for the Automatic Differentiation trace
+    int tag = 0;
+
+    // Start tracing floating point operations
+    trace_on(tag);  // Start of the active section
+
+    // Assign independent variables
+    for (int i = 0; i < n; ++i) {
+        z[i] <<= Z[i];
+    }
+
+    // Evaluate the body of the differentiated code
+    my_function(z, y);
+
+    // Assign dependent variables
+    for (int i = 0; i < m; ++i) {
+        y[i] >>= yp[i];
+    }
+
+    trace_off();    // End of the active section
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Evaluate the Jacobian of the horizon
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // One thread (same as calling jacobian() for each stage)
+    HorizonJacobian J_serial(N), J_parallel(N);
+    auto t_start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < repetitions; ++r) { horizon_jacobian(tag, N, Z.data(), J_serial, 1); }
+    auto t_end = std::chrono::high_resolution_clock::now();
+    double time_serial = std::chrono::duration<double>(t_end - t_start).count() / repetitions;
+
+    // All the available threads
+    int threads = 1;
+#ifdef ADOLC_WITH_OPENMP
+    threads = omp_get_max_threads();
+#endif
+    t_start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < repetitions; ++r) { horizon_jacobian(tag, N, Z.data(), J_parallel, threads); }
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_parallel = std::chrono::duration<double>(t_end - t_start).count() / repetitions;
+
+    // Check the Jacobians: both evaluations agree and the product with a direction dw of the horizon variables matches
+    // the central finite difference of the constraints
+    double error = 0.00;
+    for (int k = 0; k < N; ++k) {
+        for (int i = 0; i < NX; ++i) {
+            for (int j = 0; j < n; ++j) { error = fmax(error, fabs(J_serial.block(k)[i][j] - J_parallel.block(k)[i][j])); }
+        }
+    }
+    vector<double> dw(W.size()), w_plus(W.size()), w_minus(W.size());
+    vector<double> c((size_t) N*NX), c_plus((size_t) N*NX), c_minus((size_t) N*NX);
+    double h = 1e-6;
+    for (size_t i = 0; i < W.size(); ++i) {
+        dw[i] = sin(1.00 + i);
+        w_plus[i] = W[i] + h*dw[i];
+        w_minus[i] = W[i] - h*dw[i];
+    }
+    J_parallel.multiply(dw.data(), c.data());
+    constraints(N, w_plus.data(), c_plus.data());
+    constraints(N, w_minus.data(), c_minus.data());
+    double error_fd = 0.00;
+    for (size_t i = 0; i < c.size(); ++i) { error_fd = fmax(error_fd, fabs(c[i] - (c_plus[i] - c_minus[i])/(2*h))); }
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Print the results
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    cout << "Jacobian of the dynamics constraints of the horizon (N = " << N << ", nx = " << NX << ", nu = " << NU << ")" << endl;
+    cout << "Stored entries: " << J_parallel.stored() << " (dense matrix: " << J_parallel.dense() << ")" << endl;
+    cout << endl;
+    cout << setw(20) << "Threads" << setw(20) << "Time [ms]" << setw(20) << "Within 1 ms" << endl;
+    cout << setw(20) << 1 << setw(20) << time_serial*1000 << setw(20) << (time_serial < 1e-3 ? "yes" : "no") << endl;
+    cout << setw(20) << threads << setw(20) << time_parallel*1000 << setw(20) << (time_parallel < 1e-3 ? "yes" : "no") << endl;
+    cout << endl;
+    cout << "The maximum difference between the Jacobians is " << error << endl;
+    cout << "The maximum difference with the finite difference approximation is " << error_fd << endl;
+#ifndef ADOLC_WITH_OPENMP
+    cout << "ADOL-C without OpenMP support: configure ADOL-C with --with-openmp-flag=-fopenmp and build this demo with";
+    cout << " -DADOLC_OPENMP=ON to evaluate the stages in parallel" << endl;
+#endif
+    cout << endl << endl;
+
+
+
+    /* Observations:
+     *
+     *  The stage is traced once, the size of the trace does not depend on the horizon length
+     *  The stages are independent, so the time of the parallel evaluation decreases with the number of threads until
+     *  the stages per thread are too few to amortize the start of the parallel region
+     *  The ADOL-C library without OpenMP support is not thread-safe (the state of the traces is global), never call the
+     *  drivers from several threads without the ADOLC_OpenMP_Handler
+     *  The block-banded storage grows linearly with N while the dense matrix grows quadratically
+     *
+     * */
+
+    return 0;
+
+
+}
@@ -0,0 +1,487 @@
+// ------------------------------------------------------------------------------------------------------------------ //
+// Example showing a Newton method for large problems with a sparse Hessian
+//
+// A dense Hessian of 10^5 variables does not fit in memory, but the Hessian of most large problems only has a few
+// nonzeros per row. This demo implements a Newton method that exploits this structure in three steps:
+//
+//  1. Symbolic analysis (done once): the sparsity pattern of the Hessian is obtained from the trace with hess_pat(),
+//     which propagates the nonlinear interactions of the independent variables and does not need ColPack (only the
+//     drivers that also compute the seed matrix, generate_seed_hess() and sparse_hess(), do). The columns of the
+//     Hessian are grouped so that no two columns of a group have a nonzero in the same row (greedy coloring) and the
+//     elimination tree and the structure of the Cholesky factor are computed
+//  2. Numeric Hessian (every iteration): the product of the Hessian with the seed matrix of the groups is evaluated
+//     with hess_mat() and the nonzeros are read directly from the compressed result
+//  3. Numeric factorization (every iteration): left-looking sparse Cholesky factorization of the Hessian shifted by
+//     lambda*I into the structure from the symbolic analysis. The shift is increased when the Hessian is not positive
+//     definite and decreased after each successful step (Levenberg-Marquardt safeguard). A supernodal factorization
+//     would not help here: the columns of the banded factor do not share their structure (the supernodes have a
+//     single column), so there are no dense blocks to update at once
+//
+// The objective and its gradient are evaluated with zos_forward and fos_reverse on the ADOL-C trace
+//
+// ------------------------------------------------------------------------------------------------------------------ //
+
+
+// Include libraries
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <adolc/adolc.h>
+
+
+// Define namespaces
+using namespace std;                // cout, endl
+using namespace std::chrono;        // nanoseconds, system_clock, seconds
+
+
+// Greedy coloring of the columns: two columns get different colors if they have a nonzero in the same row, so each
+// nonzero of the Hessian can be read directly from the product with the seed matrix. Returns the number of colors
+int color_columns(const vector<vector<int>> &pattern, vector<int> &color) {
+    int n = (int) pattern.size(), num_colors = 0;
+    color.assign(n, -1);
+    vector<int> forbidden(n, -1);
+    for (int j = 0; j < n; ++j) {
+        for (int i : pattern[j]) {              // The pattern is symmetric: the rows of column j are pattern[j]
+            for (int k : pattern[i]) {
+                if (color[k] >= 0) { forbidden[color[k]] = j; }
+            }
+        }
+        int c = 0;
+        while (forbidden[c] == j) { ++c; }
+        color[j] = c;
+        num_colors = max(num_colors, c + 1);
+    }
+    return num_colors;
+}
+
+
+// Sparse Cholesky factorization A + shift*I = L*L^T. The matrix is given by its upper triangle in compressed columns
+// and the structure of L is computed once by the symbolic analysis and reused by every numeric factorization
+class SparseCholesky {
+
+public:
+
+    // Symbolic analysis: elimination tree, structure of L (sorted rows, diagonal first) and the rows of the upper
+    // triangle of A (the columns of its lower triangle, read by the left-looking factorization)
+    void analyze(int size, const vector<int> &Ap, const vector<int> &Ai) {
+        n = size;
+        this->Ap = Ap;
+        this->Ai = Ai;
+        parent.assign(n, -1);
+        vector<int> ancestor(n, -1);
+        for (int k = 0; k < n; ++k) {
+            for (int p = Ap[k]; p < Ap[k+1]; ++p) {
+                for (int i = Ai[p]; i != -1 && i < k; ) {
+                    int inext = ancestor[i];
+                    ancestor[i] = k;            // Path compression
+                    if (inext == -1) { parent[i] = k; break; }
+                    i = inext;
+                }
+            }
+        }
+        work.assign(n, 0.00);
+        mark.assign(n, -1);
+        reach.assign(n, 0);
+        vector<int> count(n, 1);                // Diagonal
+        for (int k = 0; k < n; ++k) {
+            int top = row_pattern(k);
+            for (int t = top; t < n; ++t) { ++count[reach[t]]; }
+        }
+        Lp.assign(n + 1, 0);
+        for (int k = 0; k < n; ++k) { Lp[k+1] = Lp[k] + count[k]; }
+        Li.assign(Lp[n], 0);
+        Lx.assign(Lp[n], 0.00);
+        next.assign(Lp.begin(), Lp.end() - 1);
+        for (int k = 0; k < n; ++k) {
+            Li[next[k]++] = k;
+            for (int t = row_pattern(k); t < n; ++t) { Li[next[reach[t]]++] = k; }
+        }
+
+        // Rows of the upper triangle: Atx[q] is the position in Ax of the entry A(j, Ati[q]) of row j
+        Atp.assign(n + 1, 0);
+        for (int p = 0; p < Ap[n]; ++p) { ++Atp[Ai[p] + 1]; }
+        for (int j = 0; j < n; ++j) { Atp[j+1] += Atp[j]; }
+        Ati.assign(Ap[n], 0);
+        Atx.assign(Ap[n], 0);
+        next.assign(Atp.begin(), Atp.end() - 1);
+        for (int k = 0; k < n; ++k) {
+            for (int p = Ap[k]; p < Ap[k+1]; ++p) {
+                int q = next[Ai[p]]++;
+                Ati[q] = k;
+                Atx[q] = p;
+            }
+        }
+    }
+
+    // Numeric factorization (left-looking, one column of L at a time). Column j is updated with the columns k < j that
+    // have a nonzero in row j, which are the row pattern of j in the elimination tree. next[k] is the position of the
+    // first entry of column k below the rows already factorized. Returns false if the matrix is not positive definite
+    bool factorize(const vector<double> &Ax, double shift) {
+        for (int k = 0; k < n; ++k) { next[k] = Lp[k] + 1; }
+        for (int j = 0; j < n; ++j) {
+            for (int q = Atp[j]; q < Atp[j+1]; ++q) { work[Ati[q]] = Ax[Atx[q]]; }
+            work[j] += shift;
+            for (int t = row_pattern(j); t < n; ++t) {
+                int k = reach[t];
+                double ljk = Lx[next[k]];
+                for (int p = next[k]++; p < Lp[k+1]; ++p) { work[Li[p]] -= Lx[p]*ljk; }
+            }
+            double d = work[j];
+            if (d <= 0.00) {
+                for (int p = Lp[j]; p < Lp[j+1]; ++p) { work[Li[p]] = 0.00; }
+                return false;
+            }
+            Lx[Lp[j]] = sqrt(d);
+            work[j] = 0.00;
+            for (int p = Lp[j] + 1; p < Lp[j+1]; ++p) {
+                Lx[p] = work[Li[p]] / Lx[Lp[j]];
+                work[Li[p]] = 0.00;
+            }
+        }
+        return true;
+    }
+
+    // Solve L*L^T*x = b (x overwrites b)
+    void solve(double * b) const {
+        for (int j = 0; j < n; ++j) {
+            b[j] /= Lx[Lp[j]];
+            for (int p = Lp[j] + 1; p < Lp[j+1]; ++p) { b[Li[p]] -= Lx[p]*b[j]; }
+        }
+        for (int j = n - 1; j >= 0; --j) {
+            for (int p = Lp[j] + 1; p < Lp[j+1]; ++p) { b[j] -= Lx[p]*b[Li[p]]; }
+            b[j] /= Lx[Lp[j]];
+        }
+    }
+
+    size_t nonzeros() const { return Lp.empty() ? 0 : Lp[n]; }
+
+private:
+
+    // Pattern of row k of L (columns j < k) in reach[top..n-1], found by walking up the elimination tree from the
+    // nonzeros of column k of A
+    int row_pattern(int k) {
+        int top = n;
+        ++visit;
+        mark[k] = visit;
+        for (int p = Ap[k]; p < Ap[k+1]; ++p) {
+            int len = 0;
+            for (int i = Ai[p]; mark[i] != visit; i = parent[i]) {
+                reach[len++] = i;
+                mark[i] = visit;
+            }
+            while (len > 0) { reach[--top] = reach[--len]; }
+        }
+        return top;
+    }
+
+    int n = 0, visit = 0;
+    vector<int> Ap, Ai, Atp, Ati, Atx, parent, mark, reach, Lp, Li, next;
+    vector<double> Lx, work;
+
+};
+
+
+// Settings of the Newton method
+struct NewtonOptions {
+    int max_iterations = 100;
+    double tolerance = 1e-8;                // Stop when the norm of the gradient is smaller than this value
+    double armijo = 1e-4;                   // Sufficient decrease parameter of the line search
+    int max_backtracking = 50;              // Maximum number of step reductions of the line search
+    double initial_shift = 1e-3;            // Initial Levenberg-Marquardt shift
+};
+
+
+// Summary of an optimization
+struct NewtonReport {
+    int iterations = 0;
+    int factorizations = 0;
+    double f = 0.00;
+    double gradient_norm = 0.00;
+    double time_symbolic = 0.00;            // Pattern, coloring and symbolic factorization [s]
+    double time_hessian = 0.00;             // Compressed Hessian evaluations [s]
+    double time_factorization = 0.00;       // Numeric factorizations and solves [s]
+    double time = 0.00;                     // Total time of the iterations [s]
+    bool converged = false;
+    bool line_search_failed = false;        // No step satisfied the sufficient decrease condition
+};
+
+
+// Newton method with sparse Hessian for the function traced with the given tag
+class Newton {
+
+public:
+
+    // The symbolic analysis is done once from the pattern of the Hessian
+    Newton(short tag, const vector<vector<int>> &pattern, NewtonOptions options = NewtonOptions())
+            : tag(tag), n((int) pattern.size()), options(options) {
+
+        auto t_start = std::chrono::high_resolution_clock::now();
+
+        // Upper triangle of the Hessian in compressed columns
+        Ap.assign(n + 1, 0);
+        for (int k = 0; k < n; ++k) {
+            for (int i : pattern[k]) { if (i <= k) { Ai.push_back(i); } }
+            Ap[k+1] = (int) Ai.size();
+        }
+        Ax.assign(Ai.size(), 0.00);
+
+        // Seed matrix of the colors and symbolic factorization
+        num_colors = color_columns(pattern, color);
+        S = myalloc2(n, num_colors);
+        HS = myalloc2(n, num_colors);
+        for (int j = 0; j < n; ++j) {
+            for (int c = 0; c < num_colors; ++c) { S[j][c] = (color[j] == c) ? 1.00 : 0.00; }
+        }
+        cholesky.analyze(n, Ap, Ai);
+
+        g = myalloc1(n);
+        d = myalloc1(n);
+        x_trial = myalloc1(n);
+
+        auto t_end = std::chrono::high_resolution_clock::now();
+        time_symbolic = std::chrono::duration<double>(t_end - t_start).count();
+
+    }
+
+    ~Newton() {
+        myfree2(S); myfree2(HS);
+        myfree1(g); myfree1(d); myfree1(x_trial);
+    }
+
+    Newton(const Newton &) = delete;
+    Newton & operator=(const Newton &) = delete;
+
+    int colors() const { return num_colors; }
+    size_t hessian_nonzeros() const { return 2*Ai.size() - n; }
+    size_t factor_nonzeros() const { return cholesky.nonzeros(); }
+
+    // Minimize the function starting from x (the solution is returned in x)
+    NewtonReport minimize(double * x) {
+
+        NewtonReport report;
+        report.time_symbolic = time_symbolic;
+        auto t_start = std::chrono::high_resolution_clock::now();
+        double shift = options.initial_shift;
+        double f = evaluate(x, g);
+
+        for (report.iterations = 0; report.iterations < options.max_iterations; ++report.iterations) {
+
+            report.gradient_norm = norm(g);
+            if (report.gradient_norm < options.tolerance) { report.converged = true; break; }
+
+            // Compressed Hessian H*S and direct recovery of the nonzeros of the upper triangle
+            auto t_0 = std::chrono::high_resolution_clock::now();
+            hess_mat(tag, n, num_colors, x, S, HS);
+            for (int k = 0; k < n; ++k) {
+                for (int p = Ap[k]; p < Ap[k+1]; ++p) { Ax[p] = HS[Ai[p]][color[k]]; }
+            }
+            auto t_1 = std::chrono::high_resolution_clock::now();
+
+            // Factorize (H + shift*I), increasing the shift until the matrix is positive definite
+            while (!cholesky.factorize(Ax, shift)) {
+                shift = fmax(10.00*shift, 1e-8);
+                ++report.factorizations;
+            }
+            ++report.factorizations;
+            for (int i = 0; i < n; ++i) { d[i] = -g[i]; }
+            cholesky.solve(d);
+            auto t_2 = std::chrono::high_resolution_clock::now();
+            report.time_hessian += std::chrono::duration<double>(t_1 - t_0).count();
+            report.time_factorization += std::chrono::duration<double>(t_2 - t_1).count();
+
+            // Backtracking line search along the Newton direction (stop without taking the step if it fails)
+            double slope = dot(g, d), step = 1.00, f_trial = f;
+            int k;
+            for (k = 0; k < options.max_backtracking; ++k) {
+                for (int i = 0; i < n; ++i) { x_trial[i] = x[i] + step*d[i]; }
+                f_trial = evaluate(x_trial, nullptr);
+                if (f_trial <= f + options.armijo*step*slope) { break; }
+                step *= 0.50;
+            }
+            if (k == options.max_backtracking) { report.line_search_failed = true; break; }
+
+            // Decrease the shift after a full step and increase it after a short step
+            shift = (step == 1.00) ? shift/10.00 : 10.00*shift;
+            for (int i = 0; i < n; ++i) { x[i] = x_trial[i]; }
+            f = f_trial;
+
+            // The last zos_forward sweep of the line search was done at the new point, only the reverse sweep is needed
+            double one = 1.00;
+            fos_reverse(tag, 1, n, &one, g);
+
+        }
+
+        auto t_end = std::chrono::high_resolution_clock::now();
+        report.f = f;
+        report.time = std::chrono::duration<double>(t_end - t_start).count();
+        return report;
+
+    }
+
+private:
+
+    // Value and gradient of the function (the gradient is skipped if the pointer is null)
+    double evaluate(const double * x, double * gradient) {
+        double f, one = 1.00;
+        zos_forward(tag, 1, n, 1, x, &f);
+        if (gradient != nullptr) { fos_reverse(tag, 1, n, &one, gradient); }
+        return f;
+    }
+
+    double dot(const double * a, const double * b) const {
+        double s = 0.00;
+        for (int i = 0; i < n; ++i) { s += a[i]*b[i]; }
+        return s;
+    }
+
+    double norm(const double * a) const { return sqrt(dot(a, a)); }
+
+    short tag;
+    int n, num_colors;
+    NewtonOptions options;
+    double time_symbolic;
+    vector<int> Ap, Ai, color;
+    vector<double> Ax;
+    SparseCholesky cholesky;
+    double **S, **HS, *g, *d, *x_trial;
+
+};
+
+
+// Define the function to be minimized: chained Rosenbrock function with a quartic coupling between x[i] and x[i+2]
+// The Hessian is pentadiagonal
+template<typename T>
+void my_function(T * x, int n, T &f) {
+    f = 0.00;
+    for (int i = 0; i < n-1; ++i) {
+        T t = x[i+1] - x[i]*x[i];
+        T r = 1.00 - x[i];
+        f += 100.00*t*t + r*r;
+    }
+    for (int i = 0; i < n-2; ++i) {
+        T s = x[i] - x[i+2];
+        T s2 = s*s;
+        f += 0.10*s2*s2;
+    }
+}
+
+
+int main() {
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Initialize problem variables
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Initialize passive variables
+    int n = 100000;             // Number of variables (a dense Hessian would need 80 GB)
+    auto xp = new double[n];    // Independent vector
+    double yp;                  // Dependent variable
+
+    // Set the starting point
+    for (int i = 0; i < n; ++i) {
+        xp[i] = 0.50 + 0.10*(i % 3);
+    }
+
+    // Initialize active variables
+    auto x = new adouble[n];
+    adouble y;
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Active section for automatic differentiation
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Set the tag for the Automatic Differentiation trace
+    int tag = 0;
+
+    // Start tracing floating point operations
+    trace_on(tag);  // Start of the active section
+
+    // Assign independent variables
+    for (int i = 0; i < n; ++i) {
+        x[i] <<= xp[i];
+    }
+
+    // Evaluate the body of the differentiated code
+    my_function(x, n, y);
+
+    // Assign dependent variables
+    y >>= yp;
+
+    trace_off();    // End of the active section
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Sparsity pattern of the Hessian (done once)
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // hess_pat() allocates the rows: HP[i][0] is the number of nonzeros of row i and HP[i][1..] are their columns. The
+    // diagonal is added because the shift of the factorization needs it
+    auto t_start = std::chrono::high_resolution_clock::now();
+    auto HP = (unsigned int **) malloc(n*sizeof(unsigned int *));
+    hess_pat(tag, n, xp, HP, 0);
+    vector<vector<int>> pattern(n);
+    for (int i = 0; i < n; ++i) {
+        pattern[i].assign(HP[i] + 1, HP[i] + 1 + HP[i][0]);
+        pattern[i].push_back(i);
+        sort(pattern[i].begin(), pattern[i].end());
+        pattern[i].erase(unique(pattern[i].begin(), pattern[i].end()), pattern[i].end());
+        free(HP[i]);
+    }
+    free(HP);
+    auto t_end = std::chrono::high_resolution_clock::now();
+    double time_pattern = std::chrono::duration<double>(t_end - t_start).count();
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Minimize the function with the Newton method
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    Newton newton(tag, pattern);
+    NewtonReport report = newton.minimize(xp);
+
+    cout << "Newton method with sparse Hessian (n = " << n << ")" << endl;
+    cout << "Nonzeros of the Hessian:        " << newton.hessian_nonzeros() << endl;
+    cout << "Nonzeros of the Cholesky factor: " << newton.factor_nonzeros() << endl;
+    cout << "Number of colors (hess_mat columns): " << newton.colors() << endl;
+    cout << endl;
+    cout << "Converged: " << (report.converged ? "yes" : "no") << " after " << report.iterations << " iterations ("
+         << report.factorizations << " factorizations)" << (report.line_search_failed ? ", the line search failed" : "")
+         << endl;
+    cout << "Final value: " << report.f << ", norm of the gradient: " << report.gradient_norm << endl;
+    cout << endl;
+    cout << setw(40) << "Step" << setw(20) << "Time [ms]" << endl;
+    cout << setw(40) << "Hessian pattern with hess_pat (once)" << setw(20) << time_pattern*1000 << endl;
+    cout << setw(40) << "Coloring and symbolic analysis (once)" << setw(20) << report.time_symbolic*1000 << endl;
+    cout << setw(40) << "Compressed Hessians (all iterations)" << setw(20) << report.time_hessian*1000 << endl;
+    cout << setw(40) << "Factorizations (all iterations)" << setw(20) << report.time_factorization*1000 << endl;
+    cout << setw(40) << "Total of the iterations" << setw(20) << report.time*1000 << endl;
+    cout << endl << endl;
+
+
+
+    /* Observations:
+     *
+     *  The number of colors does not depend on n, so the cost of each Hessian is a small multiple of the cost of the
+     *  function, and the memory is proportional to the number of nonzeros
+     *  The pattern, the coloring and the symbolic analysis are computed once and reused by every iteration
+     *  The Hessian is banded, so the Cholesky factor has no fill-in beyond the band. For a general pattern, a
+     *  fill-reducing ordering should be applied before the symbolic analysis
+     *  The chained Rosenbrock function is not convex, the shift keeps the Newton direction a descent direction
+     *  From starting points with negative components (like the classical -1.2, 1.0) the iterates only correct a few
+     *  components per iteration and the method needs a number of iterations proportional to n
+     *
+     * */
+
+    return 0;
+
+
+}
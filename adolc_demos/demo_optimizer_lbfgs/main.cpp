@@ -0,0 +1,299 @@
+// ------------------------------------------------------------------------------------------------------------------ //
+// Example showing how to use the ADOL-C trace inside a gradient-based optimizer without retaping every iteration
+//
+// The objective is traced once and the value and the gradient of every iteration are evaluated with a zos_forward
+// sweep (keep = 1) followed by a fos_reverse sweep on the same trace. The objective contains an if-else statement on
+// an adouble (Huber penalty), so the trace is only valid while the comparison gives the same result as when it was
+// recorded. ADOL-C records the comparisons with zero and zos_forward returns a negative value when one of them changes,
+// in which case the objective is retaped at the current point. This is the only situation where the optimizer retapes.
+//
+// The optimizer implements the limited-memory BFGS method (two-loop recursion) with a backtracking line search. With
+// memory = 0 it reduces to the steepest descent method with the same line search. All the vectors of the iteration
+// are allocated when the optimizer is created. The optimizer is also run retaping the objective at every evaluation
+// to measure the cost of not reusing the trace.
+//
+// ------------------------------------------------------------------------------------------------------------------ //
+
+
+// Include libraries
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <adolc/adolc.h>
+
+
+// Define namespaces
+using namespace std;                // cout, endl
+using namespace std::chrono;        // nanoseconds, system_clock, seconds
+
+
+// Threshold of the Huber penalty
+static double delta = 0.10;
+
+
+// Define the function to be minimized: generalized Rosenbrock function plus a Huber penalty on x[i]-1
+// The branch of the Huber penalty depends on the value of x[i], so the trace is only valid in a region of the space
+void my_function(adouble * x, int n, adouble &f) {
+    f = 0.00;
+    for (int i = 0; i < n-1; ++i) {
+        adouble t = x[i+1] - x[i]*x[i];
+        f += 100.00*t*t;
+    }
+    for (int i = 0; i < n; ++i) {
+        adouble r = x[i] - 1.00;
+        adouble a = fabs(r);
+        if (a - delta > 0) { f += delta*(a - 0.50*delta); }
+        else { f += 0.50*r*r; }
+    }
+}
+
+
+// Settings of the optimizer
+struct LbfgsOptions {
+    int memory = 10;                        // Number of correction pairs (0 for steepest descent)
+    int max_iterations = 10000;
+    double tolerance = 1e-6;                // Stop when the norm of the gradient is smaller than this value
+    double armijo = 1e-4;                   // Sufficient decrease parameter of the line search
+    int max_backtracking = 50;
+    bool retape_every_evaluation = false;   // Retape the objective at every evaluation (for comparison only)
+};
+
+
+// Summary of an optimization
+struct LbfgsReport {
+    int iterations = 0;
+    int evaluations = 0;                    // Number of function and gradient evaluations (zos_forward + fos_reverse)
+    int retapes = 0;                        // Number of times the objective was traced
+    double f = 0.00;
+    double gradient_norm = 0.00;
+    double time = 0.00;                     // Total time [s]
+    double time_per_iteration = 0.00;       // Average time per iteration [s]
+    bool converged = false;
+};
+
+
+// Objective function written with adoubles
+typedef void (*Objective)(adouble * x, int n, adouble &f);
+
+
+// L-BFGS optimizer driven by the ADOL-C trace of the objective
+class Lbfgs {
+
+public:
+
+    Lbfgs(short tag, int n, Objective objective, LbfgsOptions options = LbfgsOptions())
+            : tag(tag), n(n), objective(objective), options(options) {
+        int q = max(options.memory, 1);
+        S = myalloc2(q, n);
+        Y = myalloc2(q, n);
+        rho = myalloc1(q);
+        alpha = myalloc1(q);
+        g = myalloc1(n);
+        d = myalloc1(n);
+        x_trial = myalloc1(n);
+        g_trial = myalloc1(n);
+        xa = new adouble[n];
+    }
+
+    ~Lbfgs() {
+        myfree2(S); myfree2(Y);
+        myfree1(rho); myfree1(alpha); myfree1(g); myfree1(d); myfree1(x_trial); myfree1(g_trial);
+        delete[] xa;
+    }
+
+    Lbfgs(const Lbfgs &) = delete;
+    Lbfgs & operator=(const Lbfgs &) = delete;
+
+    // Minimize the objective starting from x (the solution is returned in x)
+    LbfgsReport minimize(double * x) {
+
+        report = LbfgsReport();
+        auto t_start = std::chrono::high_resolution_clock::now();
+
+        double f = evaluate(x, g);
+        int stored = 0, newest = -1;
+
+        for (report.iterations = 0; report.iterations < options.max_iterations; ++report.iterations) {
+
+            report.gradient_norm = norm(g);
+            if (report.gradient_norm < options.tolerance) { report.converged = true; break; }
+
+            // Search direction with the two-loop recursion: d = -H*g
+            for (int i = 0; i < n; ++i) { d[i] = -g[i]; }
+            for (int k = 0; k < stored; ++k) {
+                int j = (newest - k + options.memory) % options.memory;
+                alpha[j] = rho[j]*dot(S[j], d);
+                for (int i = 0; i < n; ++i) { d[i] -= alpha[j]*Y[j][i]; }
+            }
+            if (stored > 0) {
+                double gamma = dot(S[newest], Y[newest]) / dot(Y[newest], Y[newest]);
+                for (int i = 0; i < n; ++i) { d[i] *= gamma; }
+            }
+            for (int k = stored - 1; k >= 0; --k) {
+                int j = (newest - k + options.memory) % options.memory;
+                double beta = rho[j]*dot(Y[j], d);
+                for (int i = 0; i < n; ++i) { d[i] += (alpha[j] - beta)*S[j][i]; }
+            }
+
+            // Restart with the steepest descent direction if d is not a descent direction
+            double slope = dot(g, d);
+            if (slope >= 0) {
+                for (int i = 0; i < n; ++i) { d[i] = -g[i]; }
+                slope = -dot(g, g);
+                stored = 0;
+            }
+
+            // Backtracking line search (the first trial step of steepest descent is scaled with the gradient norm)
+            double step = (stored == 0 && report.iterations == 0) ? 1.00/fmax(1.00, report.gradient_norm) : 1.00;
+            double f_trial = f;
+            int k;
+            for (k = 0; k < options.max_backtracking; ++k) {
+                for (int i = 0; i < n; ++i) { x_trial[i] = x[i] + step*d[i]; }
+                f_trial = evaluate(x_trial, g_trial);
+                if (f_trial <= f + options.armijo*step*slope) { break; }
+                step *= 0.50;
+            }
+            if (k == options.max_backtracking) { break; }
+
+            // Store the correction pair s = x_trial - x, y = g_trial - g (skipped if the curvature is not positive)
+            double sy = 0.00, yy = 0.00;
+            for (int i = 0; i < n; ++i) {
+                sy += (x_trial[i] - x[i])*(g_trial[i] - g[i]);
+                yy += (g_trial[i] - g[i])*(g_trial[i] - g[i]);
+            }
+            if (options.memory > 0 && sy > 1e-12*yy) {
+                int j = (newest + 1) % options.memory;      // Overwrite the oldest pair
+                for (int i = 0; i < n; ++i) {
+                    S[j][i] = x_trial[i] - x[i];
+                    Y[j][i] = g_trial[i] - g[i];
+                }
+                rho[j] = 1.00/sy;
+                newest = j;
+                stored = min(stored + 1, options.memory);
+            }
+
+            for (int i = 0; i < n; ++i) {
+                x[i] = x_trial[i];
+                g[i] = g_trial[i];
+            }
+            f = f_trial;
+
+        }
+
+        auto t_end = std::chrono::high_resolution_clock::now();
+        report.f = f;
+        report.time = std::chrono::duration<double>(t_end - t_start).count();
+        report.time_per_iteration = report.time / max(report.iterations, 1);
+        return report;
+
+    }
+
+private:
+
+    // Record the objective at the point x
+    void record(const double * x) {
+        double f;
+        adouble fa;
+        trace_on(tag);
+        for (int i = 0; i < n; ++i) { xa[i] <<= x[i]; }
+        objective(xa, n, fa);
+        fa >>= f;
+        trace_off();
+        ++report.retapes;
+        traced = true;
+    }
+
+    // Value and gradient of the objective. The trace is reused unless a comparison changed its result
+    double evaluate(const double * x, double * gradient) {
+        double f, one = 1.00;
+        if (!traced || options.retape_every_evaluation) { record(x); }
+        int rc = zos_forward(tag, 1, n, 1, x, &f);
+        if (rc < 0) {
+            record(x);
+            zos_forward(tag, 1, n, 1, x, &f);
+        }
+        fos_reverse(tag, 1, n, &one, gradient);
+        ++report.evaluations;
+        return f;
+    }
+
+    double dot(const double * a, const double * b) const {
+        double s = 0.00;
+        for (int i = 0; i < n; ++i) { s += a[i]*b[i]; }
+        return s;
+    }
+
+    double norm(const double * a) const { return sqrt(dot(a, a)); }
+
+    short tag;
+    int n;
+    Objective objective;
+    LbfgsOptions options;
+    LbfgsReport report;
+    bool traced = false;
+    double **S, **Y, *rho, *alpha, *g, *d, *x_trial, *g_trial;
+    adouble * xa;
+
+};
+
+
+int main() {
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Initialize problem variables
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Number of variables and starting point
+    int n = 1000;
+    auto x0 = new double[n];
+    for (int i = 0; i < n; ++i) {
+        x0[i] = (i % 2 == 0) ? -1.20 : 1.00;
+    }
+    auto x = new double[n];
+
+    // Optimizers
+    LbfgsOptions lbfgs_options, descent_options, retape_options;
+    descent_options.memory = 0;
+    retape_options.retape_every_evaluation = true;
+    const char * labels[3] = {"L-BFGS", "Steepest descent", "L-BFGS (retape)"};
+    LbfgsOptions options[3] = {lbfgs_options, descent_options, retape_options};
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Minimize the function with each optimizer
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    cout << "Minimization of the Rosenbrock function with a Huber penalty (n = " << n << ")" << endl;
+    cout << setw(20) << "Optimizer" << setw(12) << "Converged" << setw(12) << "Iterations" << setw(12) << "Gradients"
+         << setw(12) << "Retapes" << setw(16) << "f" << setw(16) << "|g|" << setw(16) << "ms/iteration"
+         << setw(16) << "Total [ms]" << endl;
+
+    for (int k = 0; k < 3; ++k) {
+        for (int i = 0; i < n; ++i) { x[i] = x0[i]; }
+        Lbfgs optimizer(k, n, my_function, options[k]);
+        LbfgsReport report = optimizer.minimize(x);
+        cout << setw(20) << labels[k] << setw(12) << (report.converged ? "yes" : "no") << setw(12) << report.iterations
+             << setw(12) << report.evaluations << setw(12) << report.retapes
+             << setw(16) << report.f << setw(16) << report.gradient_norm
+             << setw(16) << report.time_per_iteration*1000 << setw(16) << report.time*1000 << endl;
+    }
+    cout << endl << endl;
+
+
+
+    /* Observations:
+     *
+     *  The optimizer retapes only when the branch of the Huber penalty changes for some x[i], which happens a few
+     *  times at the beginning of the optimization. The remaining iterations reuse the trace
+     *  Retaping at every evaluation gives the same iterates but every evaluation pays for the taping
+     *  The steepest descent method needs many more gradient evaluations than L-BFGS on the Rosenbrock function
+     *
+     * */
+
+    return 0;
+
+
+}
@@ -0,0 +1,320 @@
+// ------------------------------------------------------------------------------------------------------------------ //
+// Example showing how to read hardware performance counters around the ADOL-C drivers
+//
+// The counters are read on Linux through perf_event_open(). When the counters are not available (other operating
+// systems, virtual machines without PMU access or a restrictive /proc/sys/kernel/perf_event_paranoid) the demo still
+// runs and reports the elapsed time only.
+//
+// ------------------------------------------------------------------------------------------------------------------ //
+
+
+// Include libraries
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <adolc/adolc.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+
+// Define namespaces
+using namespace std;                // cout, endl
+using namespace std::chrono;        // nanoseconds, system_clock, seconds
+
+
+// Hardware events that are recorded for each driver call
+enum Counter { CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, BRANCH_MISSES, NUM_COUNTERS };
+
+
+// Set of hardware counters attached to the calling thread
+struct PerfCounters {
+
+    int fd[NUM_COUNTERS];
+    uint64_t value[NUM_COUNTERS];
+
+    PerfCounters() {
+        for (int k = 0; k < NUM_COUNTERS; ++k) { fd[k] = -1; value[k] = 0; }
+#ifdef __linux__
+        fd[CYCLES]        = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        fd[INSTRUCTIONS]  = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        fd[L1D_MISSES]    = open_counter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                                                             (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+        fd[LLC_MISSES]    = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        fd[BRANCH_MISSES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+#endif
+    }
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for (int k = 0; k < NUM_COUNTERS; ++k) { if (fd[k] >= 0) { close(fd[k]); } }
+#endif
+    }
+
+#ifdef __linux__
+    // Open a single counting (not sampling) event for user-space code of this thread on any CPU
+    static int open_counter(uint32_t type, uint64_t config) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+#endif
+
+    void start() {
+#ifdef __linux__
+        for (int k = 0; k < NUM_COUNTERS; ++k) {
+            if (fd[k] >= 0) { ioctl(fd[k], PERF_EVENT_IOC_RESET, 0); ioctl(fd[k], PERF_EVENT_IOC_ENABLE, 0); }
+        }
+#endif
+    }
+
+    void stop() {
+#ifdef __linux__
+        for (int k = 0; k < NUM_COUNTERS; ++k) {
+            value[k] = 0;
+            if (fd[k] >= 0) {
+                ioctl(fd[k], PERF_EVENT_IOC_DISABLE, 0);
+                if (read(fd[k], &value[k], sizeof(uint64_t)) != sizeof(uint64_t)) { value[k] = 0; }
+            }
+        }
+#endif
+    }
+
+    bool available(int k) const { return fd[k] >= 0; }
+
+};
+
+
+// Print the header of the table of results
+void print_header() {
+    cout << setw(18) << "Driver" << setw(6) << "Tag" << setw(14) << "Time [ms]"
+         << setw(16) << "Cycles" << setw(16) << "Instructions" << setw(8) << "IPC"
+         << setw(14) << "L1D misses" << setw(14) << "LLC misses" << setw(16) << "Branch misses" << endl;
+}
+
+
+// Print a single counter value or n/a if the event could not be opened
+void print_counter(const PerfCounters &counters, int k, int width) {
+    if (counters.available(k)) { cout << setw(width) << counters.value[k]; }
+    else { cout << setw(width) << "n/a"; }
+}
+
+
+// Time a driver call, read the hardware counters and print one row of the table attributed to the driver and tag
+template<typename Sweep>
+void measure(PerfCounters &counters, const char *driver, short tag, Sweep sweep) {
+
+    // Start timer and counters
+    auto t_start = std::chrono::high_resolution_clock::now();
+    counters.start();
+
+    // Evaluate the driver
+    sweep();
+
+    // Stop timer and counters
+    counters.stop();
+    auto t_end = std::chrono::high_resolution_clock::now();
+    auto elapsed_seconds = std::chrono::duration<double>(t_end - t_start).count();
+
+    // Print the results (a low IPC with many cache misses indicates a memory-bound sweep, a low IPC with many
+    // branch misses indicates a sweep dominated by the operation dispatch)
+    cout << setw(18) << driver << setw(6) << tag << setw(14) << elapsed_seconds*1000;
+    print_counter(counters, CYCLES, 16);
+    print_counter(counters, INSTRUCTIONS, 16);
+    if (counters.available(CYCLES) && counters.available(INSTRUCTIONS) && counters.value[CYCLES] > 0) {
+        auto precision = cout.precision(2);
+        cout << setw(8) << (double) counters.value[INSTRUCTIONS] / counters.value[CYCLES];
+        cout.precision(precision);
+    } else {
+        cout << setw(8) << "n/a";
+    }
+    print_counter(counters, L1D_MISSES, 14);
+    print_counter(counters, LLC_MISSES, 14);
+    print_counter(counters, BRANCH_MISSES, 16);
+    cout << endl;
+
+}
+
+
+// Define the function to be differentiated: f(x) = e^[(x0+x1+...+xn)/n]
+adouble my_function(adouble * x, int n) {
+    adouble sum;
+    for (int i = 0; i < n; ++i) {
+        sum += x[i];
+    }
+    adouble f = exp(sum/n);
+    return f;
+};
+
+
+int main() {
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Initialize problem variables
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Initialize passive variables
+    int m = 1, n = 50;          // Set n equal to the desired number of independent variables
+    auto xp = new double[n];    // Independent vector
+    auto yp = new double[m];    // Dependent vector
+
+    // Set the value of the independent variables
+    for (int i = 0; i < n; ++i) {
+        xp[i] = 1.;
+    }
+
+    // Initialize active variables
+    auto x = new adouble[n];
+    auto y = new adouble[m];
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Active section for automatic differentiation
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Set the tag for the Automatic Differentiation trace
+    int tag = 0;
+
+    // Start tracing floating point operations
+    trace_on(tag);  // Start of the active section
+
+    // Assign independent variables
+    for (int i = 0; i < n; ++i) {
+        x[i] <<= xp[i];
+    }
+
+    // Add an artificial delay if desired by performing floating point operations that do not change the result
+    // Note that sleep_for() or other waiting functions do not work when evaluating the ADOL-C trace
+    for (int j = 0; j < 1e7; ++j) {x[0] = x[0] + 0*j;}
+
+    // Evaluate the body of the differentiated code
+    y[0] = my_function(x, n);
+
+    // Assign dependent variables
+    y[0] >>= yp[0];
+
+    trace_off();    // End of the active section
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Prepare the arguments of the drivers
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Number of directions, number of weight vectors and order of the highest derivative
+    int p = n, q = m, degree = 2;
+
+    // Tangent vector for the scalar mode (first direction) and matrix of tangent directions for the vector mode
+    auto x1 = new double[n];
+    auto y1 = new double[m];
+    double **X = myalloc(n, p);
+    double **Y = myalloc(m, p);
+    for (int i = 0; i < n; ++i) {
+        x1[i] = (i == 0) ? 1.00 : 0.00;
+        for (int j = 0; j < p; ++j) {
+            X[i][j] = (i == j) ? 1.00 : 0.00;
+        }
+    }
+
+    // Weight vector for the scalar mode and weight matrix for the vector mode
+    auto u = new double[m];
+    auto z = new double[n];
+    double **U = myalloc(q, m);
+    double **Z = myalloc(q, n);
+    u[0] = 1.00;
+    U[0][0] = 1.00;
+
+    // Higher order tangent directions (only the first order coefficients are seeded) and results
+    double ***XX = myalloc3(n, p, degree);
+    double ***YY = myalloc3(m, p, degree);
+    double **XH = myalloc(n, degree);
+    double **YH = myalloc(m, degree);
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < p; ++j) {
+            for (int k = 0; k < degree; ++k) {
+                XX[i][j][k] = (i == j && k == 0) ? 1.00 : 0.00;
+            }
+        }
+        for (int k = 0; k < degree; ++k) {
+            XH[i][k] = (i == 0 && k == 0) ? 1.00 : 0.00;
+        }
+    }
+
+    // Higher order adjoints and nonzero pattern
+    double ***ZZ = myalloc3(q, n, degree+1);
+    auto **nz = new short int*[q];
+    for (int k = 0; k < q; ++k) {
+        nz[k] = new short int[n];
+    }
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Measure the drivers
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Open the hardware counters once and reuse them for all the measurements
+    PerfCounters counters;
+    if (!counters.available(CYCLES)) {
+        cout << "Hardware counters are not available (check /proc/sys/kernel/perf_event_paranoid)" << endl;
+        cout << "Only the elapsed time will be reported" << endl << endl;
+    }
+
+    // Evaluate each driver once. The reverse drivers are measured separately from the forward sweep that prepares them
+    cout << "Performance counters of the derivative sweeps (n = " << n << ", p = " << p << ", degree = " << degree << ")" << endl;
+    cout.setf(ios::fixed);
+    cout.precision(3);
+    print_header();
+
+    measure(counters, "zos_forward", tag, [&]() { zos_forward(tag, m, n, 0, xp, yp); });
+    measure(counters, "fos_forward", tag, [&]() { fos_forward(tag, m, n, 0, xp, x1, yp, y1); });
+    measure(counters, "fov_forward", tag, [&]() { fov_forward(tag, m, n, p, xp, X, yp, Y); });
+    measure(counters, "zos_forward(1)", tag, [&]() { zos_forward(tag, m, n, 1, xp, yp); });
+    measure(counters, "fos_reverse", tag, [&]() { fos_reverse(tag, m, n, u, z); });
+    measure(counters, "fov_reverse", tag, [&]() { fov_reverse(tag, m, n, q, U, Z); });
+    measure(counters, "hov_forward", tag, [&]() { hov_forward(tag, m, n, degree, p, xp, XX, yp, YY); });
+    measure(counters, "hos_forward(d+1)", tag, [&]() { hos_forward(tag, m, n, degree, degree+1, xp, XH, yp, YH); });
+    measure(counters, "hov_reverse", tag, [&]() { hov_reverse(tag, m, n, degree, q, U, ZZ, nz); });
+    cout << endl;
+
+    // Check that the counted sweeps computed the right derivatives
+    cout.precision(8);
+    cout << setw(20) << "Driver" << setw(20) << "AD derivative" << setw(25) << "Analytic derivative" << endl;
+    cout << setw(20) << "fos_forward" << setw(20) << y1[0] << setw(25) << exp(1.00)/n << endl;
+    cout << setw(20) << "fov_forward" << setw(20) << Y[0][n-1] << setw(25) << exp(1.00)/n << endl;
+    cout << setw(20) << "fos_reverse" << setw(20) << z[n-1] << setw(25) << exp(1.00)/n << endl;
+    cout << setw(20) << "fov_reverse" << setw(20) << Z[0][n-1] << setw(25) << exp(1.00)/n << endl;
+    cout << endl << endl;
+
+
+
+    /* Observations:
+     *
+     *  The artificial delay loop makes all the sweeps dominated by the traversal of the trace. Compare the IPC and the
+     *  number of branch misses of zos_forward and fov_forward: the vector mode performs p times more arithmetic per
+     *  operation, so the dispatch cost is amortized and the sweep becomes limited by the memory traffic instead
+     *
+     *  Set the kernel.perf_event_paranoid parameter to 2 or lower to allow the user-space counters
+     *
+     * */
+
+    return 0;
+
+
+}
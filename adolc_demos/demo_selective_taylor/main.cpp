@@ -0,0 +1,414 @@
+// ------------------------------------------------------------------------------------------------------------------ //
+// Example showing how to store on the Taylor stack only the values that are needed by the reverse sweep
+//
+// When zos_forward() is called with keep=1 (as in demo_large_problem before fos_reverse()), ADOL-C writes the old
+// value of every location that is overwritten to the Taylor stack, and the reverse sweep restores these values in
+// reverse order. However, most reverse kernels never read a value: the adjoints of additions, subtractions and
+// products by constants do not depend on the values of their arguments. Only the nonlinear operations need values:
+// a*b needs both arguments, a/b needs b and the result, exp() needs its result and sin() and cos() need their argument.
+//
+// This demo records the function into a small trace with locations that are reused as in ADOL-C (temporaries are
+// freed and assignments overwrite the location of the variable) and analyzes it once before the sweeps. The value
+// written by an operation must be stored when its location is overwritten only if it is read by the reverse kernel
+// of a nonlinear operation before the overwrite. The forward sweep with this selective keep mode only writes these
+// values to the Taylor stack and the reverse sweep only restores them. The size of the Taylor stack, the time of the
+// sweeps and the gradients are compared with the full keep mode and with ADOL-C.
+//
+// Unlike the expression graph of demo_dead_code_elimination, where every result has its own node, this trace reuses
+// locations: the Taylor stack only exists because locations are overwritten.
+//
+// ------------------------------------------------------------------------------------------------------------------ //
+
+
+// Include libraries
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <adolc/adolc.h>
+
+
+// Define namespaces
+using namespace std;                // cout, endl
+using namespace std::chrono;        // nanoseconds, system_clock, seconds
+
+
+// Radius of the sphere
+static double R = 2.00;
+
+
+// Operations of the trace (the constant operand of the _D_ operations and the index of the independent variables are
+// stored in the operation)
+enum Opcode {ASSIGN_IND, ASSIGN_D, ASSIGN_A, PLUS_A_A, MINUS_A_A, MULT_A_A, DIV_A_A, PLUS_D_A, MULT_D_A, EXP, SIN, COS};
+
+struct Operation {
+    Opcode op;
+    int arg1, arg2, res;
+    double constant;
+};
+
+
+// Trace recorded between begin() and end() with reusable locations, analogous to an ADOL-C trace
+class Trace {
+
+public:
+
+    vector<Operation> operations;
+    vector<int> dependents;
+    int num_independents = 0, num_locations = 0;
+
+    void begin() {
+        operations.clear(); dependents.clear(); free_locations.clear();
+        num_independents = 0; num_locations = 0;
+        active = this;
+    }
+    void end() { active = nullptr; }
+
+    static int new_location() {
+        if (active->free_locations.empty()) { return active->num_locations++; }
+        int loc = active->free_locations.back();
+        active->free_locations.pop_back();
+        return loc;
+    }
+
+    static void free_location(int loc) { if (active) { active->free_locations.push_back(loc); } }
+
+    static void add(Opcode op, int arg1, int arg2, int res, double constant) {
+        active->operations.push_back({op, arg1, arg2, res, constant});
+    }
+
+    static Trace * active;
+
+private:
+
+    vector<int> free_locations;
+
+};
+
+Trace * Trace::active = nullptr;
+
+
+// Active variable of the trace: owns a location that is freed when the variable is destroyed
+class Var {
+
+public:
+
+    Var() : Var(0.00) {}
+    Var(double c) : loc(Trace::new_location()) { Trace::add(ASSIGN_D, -1, -1, loc, c); }
+    Var(const Var &other) : loc(Trace::new_location()) { Trace::add(ASSIGN_A, other.loc, -1, loc, 0.00); }
+    Var(Var &&other) noexcept : loc(other.loc) { other.loc = -1; }
+    ~Var() { if (loc >= 0) { Trace::free_location(loc); } }
+
+    Var & operator=(const Var &other) {
+        if (other.loc != loc) { Trace::add(ASSIGN_A, other.loc, -1, loc, 0.00); }
+        return *this;
+    }
+
+    // Assignment of a temporary: the result location of the last operation is moved to this variable, as ADOL-C does
+    Var & operator=(Var &&other) {
+        Operation &last = Trace::active->operations.back();
+        if (last.res == other.loc) { last.res = loc; }
+        else { Trace::add(ASSIGN_A, other.loc, -1, loc, 0.00); }
+        return *this;
+    }
+
+    Var & operator+=(const Var &other) {
+        Trace::add(PLUS_A_A, loc, other.loc, loc, 0.00);
+        return *this;
+    }
+
+    Var & operator<<=(double) {
+        Trace::add(ASSIGN_IND, -1, -1, loc, Trace::active->num_independents++);
+        return *this;
+    }
+
+    Var & operator>>=(double &) {
+        Trace::active->dependents.push_back(loc);
+        return *this;
+    }
+
+    friend Var operator+(const Var &a, const Var &b) { return make(PLUS_A_A, a.loc, b.loc, 0.00); }
+    friend Var operator-(const Var &a, const Var &b) { return make(MINUS_A_A, a.loc, b.loc, 0.00); }
+    friend Var operator*(const Var &a, const Var &b) { return make(MULT_A_A, a.loc, b.loc, 0.00); }
+    friend Var operator/(const Var &a, const Var &b) { return make(DIV_A_A, a.loc, b.loc, 0.00); }
+    friend Var operator+(const Var &a, double c) { return make(PLUS_D_A, a.loc, -1, c); }
+    friend Var operator*(double c, const Var &a) { return make(MULT_D_A, a.loc, -1, c); }
+    friend Var operator/(const Var &a, double c) { return make(MULT_D_A, a.loc, -1, 1.00/c); }
+    friend Var exp(const Var &a) { return make(EXP, a.loc, -1, 0.00); }
+    friend Var sin(const Var &a) { return make(SIN, a.loc, -1, 0.00); }
+    friend Var cos(const Var &a) { return make(COS, a.loc, -1, 0.00); }
+
+private:
+
+    static Var make(Opcode op, int arg1, int arg2, double constant) {
+        Var result(nullptr);
+        result.loc = Trace::new_location();
+        Trace::add(op, arg1, arg2, result.loc, constant);
+        return result;
+    }
+
+    explicit Var(nullptr_t) : loc(-1) {}
+
+    int loc;
+
+};
+
+
+// Analyze the trace and return for each operation whether the old value of its result location must be stored on the
+// Taylor stack. The value written by the operation w is needed when a reverse kernel reads it (an argument of a
+// nonlinear operation, or the result of a/b and exp()) before the location is overwritten by a later operation
+vector<bool> selective_keep(const Trace &trace) {
+    size_t size = trace.operations.size();
+    vector<bool> store(size, false), needed(size, false);
+    vector<int> writer(trace.num_locations, -1);
+    auto read = [&](int loc) { if (writer[loc] >= 0) { needed[writer[loc]] = true; } };
+    for (size_t k = 0; k < size; ++k) {
+        const Operation &o = trace.operations[k];
+        switch (o.op) {
+            case MULT_A_A: read(o.arg1); read(o.arg2); break;
+            case DIV_A_A:  read(o.arg2); break;
+            case SIN:      read(o.arg1); break;
+            case COS:      read(o.arg1); break;
+            default: break;
+        }
+        // All the reads of the overwritten value happened before this operation
+        if (writer[o.res] >= 0) { store[k] = needed[writer[o.res]]; }
+        writer[o.res] = (int) k;
+        if (o.op == DIV_A_A || o.op == EXP) { needed[k] = true; }
+    }
+    return store;
+}
+
+
+// Zero-order forward sweep with keep and first-order reverse sweep over the trace. Without a selection (store is
+// empty) the old value of every result location is written to the Taylor stack, as zos_forward() with keep=1
+class KeepSweeps {
+
+public:
+
+    KeepSweeps(const Trace &trace, vector<bool> store = {})
+            : trace(trace), store(std::move(store)), values(trace.num_locations), adjoints(trace.num_locations) {}
+
+    void forward(const double * x, double * y) {
+        taylors.clear();
+        vector<double> &v = values;
+        size_t k = 0;
+        for (const Operation &o : trace.operations) {
+            if (store.empty() || store[k]) { taylors.push_back(v[o.res]); }
+            switch (o.op) {
+                case ASSIGN_IND: v[o.res] = x[(int) o.constant]; break;
+                case ASSIGN_D:   v[o.res] = o.constant; break;
+                case ASSIGN_A:   v[o.res] = v[o.arg1]; break;
+                case PLUS_A_A:   v[o.res] = v[o.arg1] + v[o.arg2]; break;
+                case MINUS_A_A:  v[o.res] = v[o.arg1] - v[o.arg2]; break;
+                case MULT_A_A:   v[o.res] = v[o.arg1] * v[o.arg2]; break;
+                case DIV_A_A:    v[o.res] = v[o.arg1] / v[o.arg2]; break;
+                case PLUS_D_A:   v[o.res] = v[o.arg1] + o.constant; break;
+                case MULT_D_A:   v[o.res] = o.constant * v[o.arg1]; break;
+                case EXP:        v[o.res] = exp(v[o.arg1]); break;
+                case SIN:        v[o.res] = sin(v[o.arg1]); break;
+                case COS:        v[o.res] = cos(v[o.arg1]); break;
+            }
+            ++k;
+        }
+        for (size_t i = 0; i < trace.dependents.size(); ++i) { y[i] = v[trace.dependents[i]]; }
+        stack_size = taylors.size();
+    }
+
+    // The result value is read before the old value of the location is restored, the arguments after
+    void reverse(const double * u, double * z) {
+        vector<double> &v = values, &a = adjoints;
+        fill(a.begin(), a.end(), 0.00);
+        for (size_t i = 0; i < trace.dependents.size(); ++i) { a[trace.dependents[i]] += u[i]; }
+        for (size_t k = trace.operations.size(); k-- > 0;) {
+            const Operation &o = trace.operations[k];
+            double r = a[o.res], result = v[o.res];
+            a[o.res] = 0.00;
+            if (store.empty() || store[k]) {
+                v[o.res] = taylors.back();
+                taylors.pop_back();
+            }
+            switch (o.op) {
+                case ASSIGN_IND: z[(int) o.constant] = r; break;
+                case ASSIGN_D:   break;
+                case ASSIGN_A:   a[o.arg1] += r; break;
+                case PLUS_A_A:   a[o.arg1] += r; a[o.arg2] += r; break;
+                case MINUS_A_A:  a[o.arg1] += r; a[o.arg2] -= r; break;
+                case MULT_A_A:   a[o.arg1] += r*v[o.arg2]; a[o.arg2] += r*v[o.arg1]; break;
+                case DIV_A_A:    a[o.arg1] += r/v[o.arg2]; a[o.arg2] -= r*result/v[o.arg2]; break;
+                case PLUS_D_A:   a[o.arg1] += r; break;
+                case MULT_D_A:   a[o.arg1] += r*o.constant; break;
+                case EXP:        a[o.arg1] += r*result; break;
+                case SIN:        a[o.arg1] += r*cos(v[o.arg1]); break;
+                case COS:        a[o.arg1] -= r*sin(v[o.arg1]); break;
+            }
+        }
+    }
+
+    size_t stack_size = 0;
+
+private:
+
+    const Trace &trace;
+    vector<bool> store;
+    vector<double> values, adjoints, taylors;
+
+};
+
+
+// Define the functions to be differentiated: f(x) = e^[(x0+x1+...+xn)/n] after the delay loop of demo_large_problem,
+// and the sphere of demo_mimo_vector
+template<typename T>
+void my_function_large(T * x, int n, int iterations, T * y) {
+    for (int j = 0; j < iterations; ++j) { x[0] = x[0] + 0*j; }
+    T sum = 0.00;
+    for (int i = 0; i < n; ++i) {
+        sum += x[i];
+    }
+    y[0] = exp(sum/n);
+}
+
+template<typename T>
+void my_function_sphere(T * x, int, int, T * y) {
+    T u = x[0];
+    T v = x[1];
+    y[0] = R*cos(u)*cos(v);
+    y[1] = R*sin(u)*cos(v);
+    y[2] = R*sin(v);
+}
+
+
+// Record the function into the trace
+void record(void (*f)(Var *, int, int, Var *), Trace &trace, int m, int n, int iterations, const double * xp) {
+    vector<double> yp(m);
+    trace.begin();
+    {
+        vector<Var> x(n), y(m);
+        for (int i = 0; i < n; ++i) { x[i] <<= xp[i]; }
+        f(x.data(), n, iterations, y.data());
+        for (int i = 0; i < m; ++i) { y[i] >>= yp[i]; }
+    }
+    trace.end();
+}
+
+
+int main() {
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Initialize problem variables
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Number of independent variables and iterations of the delay loop of the large problem
+    int n = 50, iterations = 1000000;
+
+    // Functions of the comparison
+    const char * labels[2] = {"Large problem", "Sphere"};
+    int dependents[2] = {1, 3}, independents[2] = {n, 2};
+    void (*functions[2])(Var *, int, int, Var *) = {my_function_large<Var>, my_function_sphere<Var>};
+
+    vector<double> xp(n, 1.00), xs = {0.50, 0.25};
+    double up[3] = {1.00, 1.00, 1.00}, yp[3];
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Compare the Taylor stack of the full and the selective keep modes
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    cout.precision(8);
+    cout.setf(ios::fixed);
+    cout << "Size of the Taylor stack and time of zos_forward (keep) + fos_reverse" << endl;
+    cout << setw(20) << "Function" << setw(15) << "Operations" << setw(15) << "Full stack" << setw(15) << "Selective"
+         << setw(15) << "Full [ms]" << setw(18) << "Selective [ms]" << setw(15) << "Difference" << endl;
+
+    for (int k = 0; k < 2; ++k) {
+
+        int m = dependents[k], nk = independents[k];
+        const double * x = (k == 0) ? xp.data() : xs.data();
+
+        Trace trace;
+        record(functions[k], trace, m, nk, iterations, x);
+
+        KeepSweeps full(trace), selective(trace, selective_keep(trace));
+        vector<double> z_full(nk), z_selective(nk);
+        double times[2];
+
+        auto t_start = std::chrono::high_resolution_clock::now();
+        full.forward(x, yp);
+        full.reverse(up, z_full.data());
+        auto t_end = std::chrono::high_resolution_clock::now();
+        times[0] = std::chrono::duration<double>(t_end - t_start).count();
+
+        t_start = std::chrono::high_resolution_clock::now();
+        selective.forward(x, yp);
+        selective.reverse(up, z_selective.data());
+        t_end = std::chrono::high_resolution_clock::now();
+        times[1] = std::chrono::duration<double>(t_end - t_start).count();
+
+        double error = 0.00;
+        for (int i = 0; i < nk; ++i) { error = fmax(error, fabs(z_full[i] - z_selective[i])); }
+
+        cout << setw(20) << labels[k] << setw(15) << trace.operations.size() << setw(15) << full.stack_size
+             << setw(15) << selective.stack_size << setw(15) << times[0]*1000 << setw(18) << times[1]*1000
+             << setw(15) << error << endl;
+
+        if (k == 0) {
+            cout << setw(20) << "" << "Gradient: " << z_selective[0] << " (analytic derivative " << exp(1.00)/n << ")"
+                 << endl;
+        }
+
+    }
+    cout << endl;
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Taylor stack of ADOL-C for the large problem
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    short tag = 0;
+    {
+        auto x = new adouble[n];
+        adouble y[1];
+        trace_on(tag);
+        for (int i = 0; i < n; ++i) { x[i] <<= xp[i]; }
+        my_function_large(x, n, iterations, y);
+        y[0] >>= yp[0];
+        trace_off();
+        delete[] x;
+    }
+
+    size_t stats[STAT_SIZE];
+    tapestats(tag, stats);
+    vector<double> z(n);
+    auto t_start = std::chrono::high_resolution_clock::now();
+    zos_forward(tag, 1, n, 1, xp.data(), yp);
+    fos_reverse(tag, 1, n, up, z.data());
+    auto t_end = std::chrono::high_resolution_clock::now();
+    double time_adolc = std::chrono::duration<double>(t_end - t_start).count();
+
+    cout << "ADOL-C (keep=1): " << stats[NUM_OPERATIONS] << " operations, Taylor stack of " << stats[TAY_STACK_SIZE]
+         << " values, " << time_adolc*1000 << " ms, gradient " << z[0] << endl;
+    cout << endl << endl;
+
+
+
+    /* Observations:
+     *
+     *  The delay loop and the sum of the large problem only contain additions and products by constants, so none of the
+     *  values they overwrite is read by the reverse sweep. The selective keep mode only stores the values read by the
+     *  exponential, which are never overwritten. The Taylor stack is reduced from one value per operation to nothing
+     *  and the sweeps are faster because they do not write and read the stack
+     *  The sphere is dominated by nonlinear operations, but its temporaries are overwritten after their values are
+     *  read, so only the values of a few reused locations are stored
+     *  The gradients are identical because the values that are not restored are never read by the reverse kernels
+     *  The analysis depends only on the trace, it is done once and reused for all the sweeps at different points
+     *
+     * */
+
+    return 0;
+
+
+}
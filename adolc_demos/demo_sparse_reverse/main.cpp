@@ -0,0 +1,345 @@
+// ------------------------------------------------------------------------------------------------------------------ //
+// Example showing how to exploit the nonzero pattern returned by hov_reverse() for wide sparse functions
+//
+// The nonzero pattern nz[i][j] of the dependent variable i with respect to the independent variable j is computed once
+// with a dense hov_reverse() sweep. The dependent variables are then grouped (colored) so that the dependents of a
+// group never depend on the same independent variable. A single weight vector per group is enough to recover all the
+// adjoints of the group, so the following reverse sweeps propagate one adjoint direction per group instead of one
+// per dependent variable. The results are returned in compressed row storage (only the structural nonzeros).
+//
+// ------------------------------------------------------------------------------------------------------------------ //
+
+
+// Include libraries
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <adolc/adolc.h>
+
+
+// Define namespaces
+using namespace std;                // cout, endl
+using namespace std::chrono;        // nanoseconds, system_clock, seconds
+
+
+// Quick factorial implementation
+int factorial(int n) { return (n == 1 || n == 0) ? 1 : factorial(n - 1) * n; }
+
+
+// Higher order adjoints in compressed row storage: the Taylor coefficients of the adjoint of the dependent i with
+// respect to the independent col[k] are stored in values[k*(d+1) + deg] for row_start[i] <= k < row_start[i+1]
+struct SparseAdjoints {
+    int m, n, d;
+    vector<int> row_start;
+    vector<int> col;
+    vector<double> values;
+};
+
+
+// Nonzero pattern, coloring of the dependent variables and workspace for the compressed reverse sweeps
+struct SparseReversePlan {
+    int m, n, d, q;         // Number of dependents, independents, highest order and number of colors
+    vector<int> color;      // Color of each dependent variable
+    SparseAdjoints pattern; // Structural nonzeros (the values are filled by each sweep)
+    double **U;             // Compressed weight matrix (size q x m)
+    double ***Z;            // Compressed adjoints (size q x n x d+1)
+    short **nz;             // Nonzero pattern of the compressed sweep
+};
+
+
+// Compute the nonzero pattern with a dense sweep and color the dependent variables
+// The trace must have been prepared with a forward sweep with keep = d+1
+SparseReversePlan sparse_reverse_plan(short tag, int m, int n, int d) {
+
+    SparseReversePlan plan;
+    plan.m = m;
+    plan.n = n;
+    plan.d = d;
+
+    // Dense reverse sweep with the identity weight matrix (only done once to get the nonzero pattern)
+    double **U = myalloc2(m, m);
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < m; ++j) {
+            U[i][j] = (i == j) ? 1.00 : 0.00;
+        }
+    }
+    double ***Z = myalloc3(m, n, d+1);
+    auto **nz = new short int*[m];
+    for (int i = 0; i < m; ++i) {
+        nz[i] = new short int[n];
+    }
+    hov_reverse(tag, m, n, d, m, U, Z, nz);
+
+    // Store the structural nonzeros in compressed row storage
+    plan.pattern.m = m;
+    plan.pattern.n = n;
+    plan.pattern.d = d;
+    plan.pattern.row_start.push_back(0);
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < n; ++j) {
+            if (nz[i][j] != 0) { plan.pattern.col.push_back(j); }
+        }
+        plan.pattern.row_start.push_back(plan.pattern.col.size());
+    }
+    plan.pattern.values.resize(plan.pattern.col.size()*(d+1));
+
+    // Greedy coloring: two dependents get the same color only if they do not share any independent variable
+    vector<vector<int>> rows_of_column(n);
+    vector<bool> forbidden;
+    plan.q = 0;
+    for (int i = 0; i < m; ++i) {
+        forbidden.assign(plan.q+1, false);
+        for (int k = plan.pattern.row_start[i]; k < plan.pattern.row_start[i+1]; ++k) {
+            for (int l : rows_of_column[plan.pattern.col[k]]) { forbidden[plan.color[l]] = true; }
+            rows_of_column[plan.pattern.col[k]].push_back(i);
+        }
+        int c = 0;
+        while (forbidden[c]) { ++c; }
+        plan.color.push_back(c);
+        if (c == plan.q) { ++plan.q; }
+    }
+
+    // Compressed weight matrix: row c sums the dependents with color c
+    plan.U = myalloc2(plan.q, m);
+    for (int c = 0; c < plan.q; ++c) {
+        for (int i = 0; i < m; ++i) {
+            plan.U[c][i] = (plan.color[i] == c) ? 1.00 : 0.00;
+        }
+    }
+
+    // Workspace of the compressed sweeps
+    plan.Z = myalloc3(plan.q, n, d+1);
+    plan.nz = new short int*[plan.q];
+    for (int c = 0; c < plan.q; ++c) {
+        plan.nz[c] = new short int[n];
+    }
+
+    // Release the dense workspace
+    myfree2(U);
+    myfree3(Z);
+    for (int i = 0; i < m; ++i) {
+        delete[] nz[i];
+    }
+    delete[] nz;
+
+    return plan;
+
+}
+
+
+// Compute the higher order adjoints of all the dependent variables with one adjoint direction per color
+// The trace must have been prepared with a forward sweep with keep = d+1
+int sparse_hov_reverse(short tag, SparseReversePlan &plan, SparseAdjoints &adjoints) {
+
+    // Propagate the compressed weight matrix
+    int rc = hov_reverse(tag, plan.m, plan.n, plan.d, plan.q, plan.U, plan.Z, plan.nz);
+
+    // Scatter the compressed adjoints into compressed row storage
+    adjoints = plan.pattern;
+    for (int i = 0; i < plan.m; ++i) {
+        for (int k = adjoints.row_start[i]; k < adjoints.row_start[i+1]; ++k) {
+            for (int deg = 0; deg <= plan.d; ++deg) {
+                adjoints.values[k*(plan.d+1) + deg] = plan.Z[plan.color[i]][adjoints.col[k]][deg];
+            }
+        }
+    }
+
+    return rc;
+
+}
+
+
+// Define the function to be differentiated: fi(x) = e^[(xi + xi+1)/2] with a banded sparsity pattern
+adouble* my_function(adouble * x, int n) {
+    auto * f = new adouble[n];
+    for (int i = 0; i < n; ++i) {
+        f[i] = exp((x[i] + x[(i+1) % n])/2);
+    }
+    return f;
+};
+
+double* my_function(const double * x, int n) {
+    auto * f = new double[n];
+    for (int i = 0; i < n; ++i) {
+        f[i] = exp((x[i] + x[(i+1) % n])/2);
+    }
+    return f;
+};
+
+
+int main() {
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Initialize problem variables
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Initialize passive variables
+    int n = 200, m = n;
+    auto xp = new double[n];    // Independent vector
+    auto yp = new double[m];    // Dependent vector
+
+    // Set the value of the independent variables
+    for (int i = 0; i < n; ++i) {
+        xp[i] = (double) i / n;
+    }
+
+    // Initialize active variables
+    auto x = new adouble[n];
+    auto y = new adouble[m];
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Active section for automatic differentiation
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Set the tag for the Automatic Differentiation trace
+    int tag = 0;
+
+    // Start tracing floating point operations
+    trace_on(tag);  // Start of the active section
+
+    // Assign independent variables
+    for (int i = 0; i < n; ++i) {
+        x[i] <<= xp[i];
+    }
+
+    // Evaluate the body of the differentiated code
+    auto temp = my_function(x, n);
+    for (int i = 0; i < m; ++i) {
+        y[i] = temp[i];
+    }
+
+    // Assign dependent variables
+    for (int i = 0; i < m; ++i) {
+        y[i] >>= yp[i];
+    }
+
+    trace_off();    // End of the active section
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Run a forward sweep with keep=d+1 to prepare the trace for high-order reverse differentiation
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Define the order of the highest derivative
+    int degree = 2;
+
+    // Define a flag to prepare for a reverse automatic differentiation
+    int keep = degree+1;
+
+    // Declare the matrix of Taylor coefficients of the dependent variables
+    double **YY = myalloc(m, degree);
+
+    // Initialize the Taylor coefficients of the independent variables (direction v = [1, 1, ..., 1])
+    double **XX = myalloc(n, degree);
+    for (int i = 0; i < n; ++i) {
+        for (int deg = 0; deg < degree; ++deg) {
+            XX[i][deg] = (deg == 0) ? 1.00 : 0.00;
+        }
+    }
+
+    // Run the forward mode with keep=degree+1
+    hos_forward(tag, m, n, degree, keep, xp, XX, yp, YY);
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Compute the higher order adjoints in dense reverse vector mode (one weight vector per dependent)
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Define the identity weight matrix
+    int q = m;
+    double **U = myalloc(q, m);
+    for (int i = 0; i < q; ++i) {
+        for (int j = 0; j < m; ++j) {
+            U[i][j] = (i == j) ? 1.00 : 0.00;
+        }
+    }
+
+    // Declare the dense matrix of adjoints and the nonzero pattern
+    double ***Z = myalloc(q, n, degree+1);
+    auto **nz = new short int*[q];
+    for (int k = 0; k < q; ++k) {
+        nz[k] = new short int[n];
+    }
+
+    // Compute the matrix of adjoints
+    auto t_start = std::chrono::high_resolution_clock::now();
+    hov_reverse(tag, m, n, degree, q, U, Z, nz);
+    auto t_end = std::chrono::high_resolution_clock::now();
+    double time_dense = std::chrono::duration<double>(t_end - t_start).count();
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Compute the higher order adjoints in compressed reverse vector mode (one weight vector per color)
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Compute the nonzero pattern and the coloring once
+    t_start = std::chrono::high_resolution_clock::now();
+    SparseReversePlan plan = sparse_reverse_plan(tag, m, n, degree);
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_plan = std::chrono::duration<double>(t_end - t_start).count();
+
+    // Compute the sparse matrix of adjoints (this is the part that is repeated in an iterative method)
+    SparseAdjoints adjoints;
+    t_start = std::chrono::high_resolution_clock::now();
+    sparse_hov_reverse(tag, plan, adjoints);
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_sparse = std::chrono::duration<double>(t_end - t_start).count();
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Compare the results
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Compare the sparse, dense and analytic derivatives of the first dependent variables. Along the direction v the
+    // scaled Taylor coefficients of the adjoints are all equal to dfi/dxj = fi/2 for j = i, i+1
+    auto f = my_function(xp, n);
+    cout << "Higher order adjoints in dense and compressed reverse mode" << endl;
+    cout << setw(12) << "Dependent" << setw(12) << "Independent" << setw(8) << "Order" << setw(20) << "Dense adjoint"
+         << setw(20) << "Sparse adjoint" << setw(25) << "Analytic derivative" << endl;
+    cout.precision(8);
+    cout.setf(ios::fixed);
+    for (int i = 0; i < 3; ++i) {
+        for (int k = adjoints.row_start[i]; k < adjoints.row_start[i+1]; ++k) {
+            int j = adjoints.col[k];
+            for (int deg = 0; deg <= degree; ++deg) {
+                cout << setw(12) << i+1 << setw(12) << j+1 << setw(8) << deg
+                     << setw(20) << Z[i][j][deg]*factorial(deg)
+                     << setw(20) << adjoints.values[k*(degree+1) + deg]*factorial(deg)
+                     << setw(25) << f[i]/2 << endl;
+            }
+        }
+    }
+    cout << endl;
+
+    // Print the memory and time comparison
+    cout << "Number of weight vectors propagated:  dense = " << q << ", compressed = " << plan.q << endl;
+    cout << "Number of adjoint values stored:      dense = " << q*n*(degree+1)
+         << ", compressed = " << adjoints.values.size() << endl;
+    cout << "The elapsed time of the dense sweep was       " << time_dense*1000 << " milliseconds" << endl;
+    cout << "The elapsed time of the sparsity analysis was " << time_plan*1000 << " milliseconds" << endl;
+    cout << "The elapsed time of the compressed sweep was  " << time_sparse*1000 << " milliseconds" << endl;
+    cout << endl << endl;
+
+
+
+    /* Observations:
+     *
+     *  The sparsity analysis costs as much as one dense sweep but it is only done once for a given trace
+     *  The compressed sweep propagates as many weight vectors as colors (2 for this banded function) instead of m
+     *  The adjoints are only stored for the structural nonzeros of the nonzero pattern
+     *
+     * */
+
+    return 0;
+
+
+}
@@ -0,0 +1,288 @@
+// ------------------------------------------------------------------------------------------------------------------ //
+// Example showing how to compute the gradient of a tiny function in reverse mode with a local tape on the stack
+//
+// For functions with a few operations, such as e^x (demo_siso) or a quadratic form (demo_miso_scalar), the cost of
+// trace_on()/trace_off(), the tag management and the tape buffers of ADOL-C is much larger than the cost of the
+// function itself. The active type of this demo records each elemental operation into a tape of fixed capacity that
+// is a local variable of the caller. Each entry stores the indices of the arguments and the partial derivatives of the
+// operation, which are computed with the same elemental functions during the evaluation, so the gradient is obtained
+// right after the evaluation with one backward loop over the entries.
+//
+// The variables keep a pointer to their tape and there is no global state: every thread (or every call) uses its own
+// tape. The tape cannot be reused at a different point, it is recorded again in every call.
+//
+// ------------------------------------------------------------------------------------------------------------------ //
+
+
+// Include libraries
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <adolc/adolc.h>
+
+
+// Define namespaces
+using namespace std;                // cout, endl
+using namespace std::chrono;        // nanoseconds, system_clock, seconds
+
+
+// Operation recorded in a local tape: up to two arguments with their partial derivatives (argument -1 is unused)
+struct LocalEntry {
+    int arg[2];
+    double partial[2];
+};
+
+
+// Local tape with external storage for the entries and the adjoints
+class LocalTape {
+
+public:
+
+    LocalTape(LocalEntry * entries, double * adjoints, int capacity)
+            : entries(entries), adjoints(adjoints), capacity(capacity) {}
+
+    // Record an operation and return the index of its result
+    int record(int a = -1, double da = 0.00, int b = -1, double db = 0.00) {
+        if (size == capacity) { throw length_error("LocalTape: capacity exceeded"); }
+        entries[size] = {{a, b}, {da, db}};
+        return size++;
+    }
+
+    // Propagate the adjoint of the entry y backwards and return the adjoints of all the entries
+    const double * reverse(int y) {
+        for (int k = 0; k < size; ++k) { adjoints[k] = 0.00; }
+        adjoints[y] = 1.00;
+        for (int k = y; k >= 0; --k) {
+            double a = adjoints[k];
+            if (a == 0.00) { continue; }
+            const LocalEntry &e = entries[k];
+            if (e.arg[0] >= 0) { adjoints[e.arg[0]] += e.partial[0]*a; }
+            if (e.arg[1] >= 0) { adjoints[e.arg[1]] += e.partial[1]*a; }
+        }
+        return adjoints;
+    }
+
+    void clear() { size = 0; }
+    int entries_used() const { return size; }
+
+private:
+
+    LocalEntry * entries;
+    double * adjoints;
+    int capacity, size = 0;
+
+};
+
+
+// Local tape with the storage for CAPACITY operations on the stack
+template<int CAPACITY>
+class StackTape : public LocalTape {
+
+public:
+
+    StackTape() : LocalTape(storage, adjoint_storage, CAPACITY) {}
+
+    StackTape(const StackTape &) = delete;
+    StackTape & operator=(const StackTape &) = delete;
+
+private:
+
+    LocalEntry storage[CAPACITY];
+    double adjoint_storage[CAPACITY];
+
+};
+
+
+// Active variable of a local tape
+class rdouble {
+
+public:
+
+    rdouble(double value = 0.00) : v(value) {}
+    rdouble(LocalTape * tape, double value, int index) : v(value), index(index), tape(tape) {}
+
+    double value() const { return v; }
+
+    double v;
+    int index = -1;             // Entry of the tape (-1 for a passive value)
+    LocalTape * tape = nullptr;
+
+};
+
+
+// Result of an operation with one active argument and the partial derivative da
+inline rdouble unary(const rdouble &a, double value, double da) {
+    if (!a.tape) { return rdouble(value); }
+    return rdouble(a.tape, value, a.tape->record(a.index, da));
+}
+
+// Result of an operation with two arguments and the partial derivatives da and db
+inline rdouble binary(const rdouble &a, const rdouble &b, double value, double da, double db) {
+    if (!a.tape) { return unary(b, value, db); }
+    if (!b.tape) { return unary(a, value, da); }
+    return rdouble(a.tape, value, a.tape->record(a.index, da, b.index, db));
+}
+
+inline rdouble operator+(const rdouble &a, const rdouble &b) { return binary(a, b, a.v + b.v, 1.00, 1.00); }
+inline rdouble operator-(const rdouble &a, const rdouble &b) { return binary(a, b, a.v - b.v, 1.00, -1.00); }
+inline rdouble operator*(const rdouble &a, const rdouble &b) { return binary(a, b, a.v*b.v, b.v, a.v); }
+inline rdouble operator/(const rdouble &a, const rdouble &b) {
+    double r = 1.00/b.v;
+    return binary(a, b, a.v*r, r, -a.v*r*r);
+}
+inline rdouble operator-(const rdouble &a) { return unary(a, -a.v, -1.00); }
+
+inline rdouble exp(const rdouble &a) {
+    double e = exp(a.v);
+    return unary(a, e, e);
+}
+inline rdouble log(const rdouble &a) { return unary(a, log(a.v), 1.00/a.v); }
+inline rdouble sqrt(const rdouble &a) {
+    double s = sqrt(a.v);
+    return unary(a, s, 0.50/s);
+}
+inline rdouble sin(const rdouble &a) { return unary(a, sin(a.v), cos(a.v)); }
+inline rdouble cos(const rdouble &a) { return unary(a, cos(a.v), -sin(a.v)); }
+
+
+// Gradient of f: R^n -> R with a local tape of capacity CAPACITY. Returns the value of the function
+template<int CAPACITY>
+double local_gradient(rdouble (*f)(const rdouble *), int n, const double * xp, double * g) {
+    StackTape<CAPACITY> tape;
+    rdouble x[CAPACITY];
+    for (int i = 0; i < n; ++i) { x[i] = rdouble(&tape, xp[i], tape.record()); }
+    rdouble y = f(x);
+    if (!y.tape) {
+        for (int i = 0; i < n; ++i) { g[i] = 0.00; }
+        return y.v;
+    }
+    const double * adjoints = tape.reverse(y.index);
+    for (int i = 0; i < n; ++i) { g[i] = adjoints[x[i].index]; }
+    return y.v;
+}
+
+
+// Define the functions to be differentiated: f(x) = e^x and the quadratic form f(x,y,z) = x^2 + z^2 + 2*x*y + z
+template<typename T>
+T my_function_siso(const T * IN) {
+    T f = exp(IN[0]);
+    return f;
+}
+
+template<typename T>
+T my_function_miso(const T * IN) {
+    T x = IN[0], y = IN[1], z = IN[2];
+    T f = x*x + z*z + 2*x*y + z;
+    return f;
+}
+
+
+// Gradient with ADOL-C: trace the function at x (if retape is true) and call the gradient driver
+void adolc_gradient(adouble (*f)(const adouble *), short tag, int n, const double * xp, double * g, bool retape) {
+    if (retape) {
+        double yp;
+        adouble x[3], y;        // n <= 3 in this demo
+        trace_on(tag);
+        for (int i = 0; i < n; ++i) { x[i] <<= xp[i]; }
+        y = f(x);
+        y >>= yp;
+        trace_off();
+    }
+    gradient(tag, n, xp, g);
+}
+
+
+int main() {
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Initialize problem variables
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Number of gradient evaluations at different points
+    int calls = 100000;
+
+    // Functions of the comparison
+    const char * labels[2] = {"e^x", "Quadratic form"};
+    int dimensions[2] = {1, 3};
+    adouble (*adolc_functions[2])(const adouble *) = {my_function_siso<adouble>, my_function_miso<adouble>};
+    rdouble (*local_functions[2])(const rdouble *) = {my_function_siso<rdouble>, my_function_miso<rdouble>};
+
+    double xp[3], g_adolc[3], g_local[3];
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Compute the gradients with ADOL-C and with the local tape
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    cout.precision(8);
+    cout.setf(ios::fixed);
+    cout << "Average time of one gradient evaluation (" << calls << " evaluations at different points)" << endl;
+    cout << setw(20) << "Function" << setw(25) << "ADOL-C retape [us]" << setw(25) << "ADOL-C reuse [us]"
+         << setw(25) << "Local tape [us]" << setw(20) << "Difference" << endl;
+
+    for (int k = 0; k < 2; ++k) {
+
+        int n = dimensions[k];
+        short tag = k;
+        double times[3], error = 0.00;
+
+        // ADOL-C retaping at every point and reusing the trace of the first point
+        for (int mode = 0; mode < 2; ++mode) {
+            for (int i = 0; i < n; ++i) { xp[i] = 1.00; }
+            adolc_gradient(adolc_functions[k], tag, n, xp, g_adolc, true);
+            auto t_start = std::chrono::high_resolution_clock::now();
+            for (int c = 0; c < calls; ++c) {
+                for (int i = 0; i < n; ++i) { xp[i] = 1.00 + 1e-6*(c + i); }
+                adolc_gradient(adolc_functions[k], tag, n, xp, g_adolc, mode == 0);
+            }
+            auto t_end = std::chrono::high_resolution_clock::now();
+            times[mode] = std::chrono::duration<double>(t_end - t_start).count() / calls;
+        }
+
+        // Local tape
+        auto t_start = std::chrono::high_resolution_clock::now();
+        for (int c = 0; c < calls; ++c) {
+            for (int i = 0; i < n; ++i) { xp[i] = 1.00 + 1e-6*(c + i); }
+            local_gradient<16>(local_functions[k], n, xp, g_local);
+        }
+        auto t_end = std::chrono::high_resolution_clock::now();
+        times[2] = std::chrono::duration<double>(t_end - t_start).count() / calls;
+
+        // Compare the gradients at the last point
+        for (int i = 0; i < n; ++i) { error = fmax(error, fabs(g_adolc[i] - g_local[i])); }
+
+        cout << setw(20) << labels[k] << setw(25) << times[0]*1e6 << setw(25) << times[1]*1e6
+             << setw(25) << times[2]*1e6 << setw(20) << error << endl;
+
+    }
+    cout << endl;
+
+    // Gradient of the quadratic form at (1, 1, 1): [2x + 2y, 2x, 2z + 1] = [4, 2, 3]
+    for (int i = 0; i < 3; ++i) { xp[i] = 1.00; }
+    double f = local_gradient<16>(my_function_miso<rdouble>, 3, xp, g_local);
+    cout << "Quadratic form at (1, 1, 1): f = " << f << ", gradient = [" << g_local[0] << ", " << g_local[1] << ", "
+         << g_local[2] << "]" << endl;
+    cout << endl << endl;
+
+
+
+    /* Observations:
+     *
+     *  Retaping with ADOL-C at every point is dominated by trace_on()/trace_off() and the tape buffers, not by the
+     *  operations of the function. Reusing the trace avoids the taping but the drivers still read the tape and manage
+     *  the Taylor buffers in every call
+     *  The local tape only records a few entries on the stack and sweeps them once, so it is the fastest option for
+     *  functions with a handful of operations
+     *  The capacity of the local tape is a template parameter, a function with more operations than the capacity
+     *  throws length_error. For large functions the ADOL-C trace (recorded once and reused) is still preferable
+     *
+     * */
+
+    return 0;
+
+
+}
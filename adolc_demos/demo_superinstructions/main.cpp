@@ -0,0 +1,558 @@
+// ------------------------------------------------------------------------------------------------------------------ //
+// Example showing how to fuse frequent sequences of operations of a trace into superinstructions
+//
+// Some sequences of operations appear all over the traces of the demos: a trigonometric function multiplied by a
+// constant (R*cos(u) in demo_mimo_scalar), products added to other terms (x*x + z*z + 2*x*y + z in demo_miso_scalar)
+// and sums divided by a constant (sum/n in demo_traceless_scalar). Every operation of such a sequence is dispatched
+// separately by the sweeps and its result is stored in its own location, although it is only read by the next
+// operation.
+//
+// This demo records the function into a small expression graph and profiles the pairs (producer, consumer) of
+// operations where the result of the producer is only used by the consumer, and the chains of three operations with
+// the same property. The pairs that have a fused kernel and appear more often than a threshold are rewritten into one
+// superinstruction, with hand-written kernels for the forward and reverse sweeps:
+//
+//      MULT_ADD     a*b + c            (MULT_A_A followed by PLUS_A_A)
+//      PLUS3        a + b + c          (PLUS_A_A followed by PLUS_A_A)
+//      SCALED_MULT  c*a*b              (MULT_D_A followed by MULT_A_A)
+//      SCALED_COS   c*cos(a)           (COS followed by MULT_D_A)
+//      SCALED_SIN   c*sin(a)           (SIN followed by MULT_D_A)
+//      PLUS_SCALE   c*(a + b)          (PLUS_A_A followed by MULT_D_A)
+//
+// The zero-order forward, first-order forward and first-order reverse sweeps are timed on the original and on the
+// fused graph, and the gradient is compared with the gradient of the ADOL-C trace of the same function.
+//
+// The superinstructions have three arguments, so the sweeps run over a stream of instructions compiled from the graph.
+//
+// ------------------------------------------------------------------------------------------------------------------ //
+
+
+// Include libraries
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <array>
+#include <map>
+#include <algorithm>
+#include <string>
+#include <adolc/adolc.h>
+
+
+// Define namespaces
+using namespace std;                // cout, endl
+using namespace std::chrono;        // nanoseconds, system_clock, seconds
+
+
+// Operations of the expression graph (the constant operand of the _D_ operations is stored in the node) followed by
+// the superinstructions
+enum Opcode {CONSTANT, INDEPENDENT, PLUS_A_A, MULT_A_A, MULT_D_A, EXP, SIN, COS,
+             MULT_ADD, PLUS3, SCALED_MULT, SCALED_COS, SCALED_SIN, PLUS_SCALE, NUM_OPCODES};
+
+const char * opcode_names[NUM_OPCODES] = {"CONSTANT", "INDEPENDENT", "PLUS_A_A", "MULT_A_A", "MULT_D_A", "EXP", "SIN",
+                                          "COS", "MULT_ADD", "PLUS3", "SCALED_MULT", "SCALED_COS", "SCALED_SIN",
+                                          "PLUS_SCALE"};
+
+struct Node {
+    Opcode op;
+    int arg1, arg2;
+    double constant;
+    double value;
+};
+
+
+// Expression graph recorded between begin() and end(), analogous to an ADOL-C trace
+class Graph {
+
+public:
+
+    vector<Node> nodes;
+    vector<int> independents, dependents;
+
+    void begin() { nodes.clear(); independents.clear(); dependents.clear(); active = this; }
+    void end() { active = nullptr; }
+
+    static int add(Opcode op, int arg1, int arg2, double constant, double value) {
+        active->nodes.push_back({op, arg1, arg2, constant, value});
+        return (int) active->nodes.size() - 1;
+    }
+
+    static Graph * active;
+
+};
+
+Graph * Graph::active = nullptr;
+
+
+// Active variable of the expression graph: each operation evaluates its value and appends a node to the active graph
+class Var {
+
+public:
+
+    Var() : id(-1) {}
+    Var(double c) : id(Graph::add(CONSTANT, -1, -1, c, c)) {}
+
+    double value() const { return Graph::active->nodes[node()].value; }
+
+    Var & operator<<=(double x) {
+        id = Graph::add(INDEPENDENT, -1, -1, 0.00, x);
+        Graph::active->independents.push_back(id);
+        return *this;
+    }
+
+    Var & operator>>=(double &y) {
+        Graph::active->dependents.push_back(node());
+        y = value();
+        return *this;
+    }
+
+    Var & operator+=(const Var &b) { return *this = *this + b; }
+    Var & operator*=(const Var &b) { return *this = *this * b; }
+
+    friend Var operator+(const Var &a, const Var &b) { return make(PLUS_A_A, a, b, 0.00, a.value() + b.value()); }
+    friend Var operator*(const Var &a, const Var &b) { return make(MULT_A_A, a, b, 0.00, a.value() * b.value()); }
+
+    // Mixed operations are mapped to the same operations that ADOL-C records (a - c as a + (-c), a / c as (1/c) * a)
+    friend Var operator*(double c, const Var &a) { return make(MULT_D_A, a, a, c, c * a.value()); }
+    friend Var operator*(const Var &a, double c) { return c * a; }
+    friend Var operator/(const Var &a, double c) { return (1.00/c) * a; }
+
+    friend Var exp(const Var &a) { return make(EXP, a, a, 0.00, exp(a.value())); }
+    friend Var sin(const Var &a) { return make(SIN, a, a, 0.00, sin(a.value())); }
+    friend Var cos(const Var &a) { return make(COS, a, a, 0.00, cos(a.value())); }
+
+private:
+
+    // Node of the variable. A default-constructed variable is zero and records its constant only when it is read, so
+    // the variables that are assigned before they are read (such as the independent variables) do not leave a node
+    int node() const {
+        if (id < 0) { id = Graph::add(CONSTANT, -1, -1, 0.00, 0.00); }
+        return id;
+    }
+
+    static Var make(Opcode op, const Var &a, const Var &b, double constant, double value) {
+        Var result;
+        result.id = Graph::add(op, a.node(), b.node(), constant, value);
+        return result;
+    }
+
+    mutable int id;
+
+};
+
+
+// Instruction of the stream swept by the interpreters: a node of the graph or a superinstruction with three arguments
+struct Instruction {
+    Opcode op;
+    int arg1, arg2, arg3;
+    double constant;
+};
+
+// Instruction stream of a graph. The result of instruction k is stored in location k of the sweeps
+struct Program {
+    vector<Instruction> code;
+    vector<int> independents, dependents;
+};
+
+
+// Instruction stream with one instruction for each node of the graph
+Program compile(const Graph &graph) {
+    Program program;
+    for (const Node &node : graph.nodes) { program.code.push_back({node.op, node.arg1, node.arg2, -1, node.constant}); }
+    program.independents = graph.independents;
+    program.dependents = graph.dependents;
+    return program;
+}
+
+
+// Number of arguments of each operation
+int arity(Opcode op) {
+    switch (op) {
+        case CONSTANT: case INDEPENDENT: return 0;
+        case MULT_D_A: case EXP: case SIN: case COS: case SCALED_COS: case SCALED_SIN: return 1;
+        case MULT_ADD: case PLUS3: return 3;
+        default: return 2;
+    }
+}
+
+
+// Number of uses of the result of each node (the dependents count as one use)
+vector<int> use_counts(const Program &program) {
+    vector<int> uses(program.code.size(), 0);
+    for (const Instruction &node : program.code) {
+        int args[3] = {node.arg1, node.arg2, node.arg3};
+        for (int a = 0; a < arity(node.op); ++a) { ++uses[args[a]]; }
+    }
+    for (int d : program.dependents) { ++uses[d]; }
+    return uses;
+}
+
+
+// Frequency of the sequences of two and three operations where each result is only used by the next operation
+struct Profile {
+    map<pair<int, int>, int> bigrams;
+    map<array<int, 3>, int> trigrams;
+};
+
+Profile profile(const Program &program) {
+    Profile p;
+    vector<int> uses = use_counts(program);
+    for (const Instruction &node : program.code) {
+        int args[3] = {node.arg1, node.arg2, node.arg3};
+        for (int a = 0; a < arity(node.op); ++a) {
+            if (a == 1 && args[1] == args[0]) { continue; }
+            const Instruction &producer = program.code[args[a]];
+            if (uses[args[a]] != 1 || arity(producer.op) == 0) { continue; }
+            ++p.bigrams[{producer.op, node.op}];
+            int pargs[3] = {producer.arg1, producer.arg2, producer.arg3};
+            for (int b = 0; b < arity(producer.op); ++b) {
+                const Instruction &first = program.code[pargs[b]];
+                if (uses[pargs[b]] != 1 || arity(first.op) == 0) { continue; }
+                ++p.trigrams[{first.op, producer.op, node.op}];
+            }
+        }
+    }
+    return p;
+}
+
+
+// Fused operation for the pair (producer, consumer), or NUM_OPCODES if there is no superinstruction for the pair
+Opcode superinstruction(Opcode producer, Opcode consumer) {
+    if (producer == MULT_A_A && consumer == PLUS_A_A) { return MULT_ADD; }
+    if (producer == PLUS_A_A && consumer == PLUS_A_A) { return PLUS3; }
+    if (producer == MULT_D_A && consumer == MULT_A_A) { return SCALED_MULT; }
+    if (producer == COS && consumer == MULT_D_A) { return SCALED_COS; }
+    if (producer == SIN && consumer == MULT_D_A) { return SCALED_SIN; }
+    if (producer == PLUS_A_A && consumer == MULT_D_A) { return PLUS_SCALE; }
+    return NUM_OPCODES;
+}
+
+
+// Rewrite the pairs whose frequency is at least threshold times the number of nodes into superinstructions. The fused
+// producers are removed and the remaining nodes are renumbered
+Program fuse(const Program &program, const Profile &p, double threshold) {
+
+    size_t size = program.code.size();
+    vector<Instruction> nodes = program.code;
+    vector<int> uses = use_counts(program);
+    vector<bool> removed(size, false);
+
+    for (size_t k = 0; k < size; ++k) {
+        Instruction &node = nodes[k];
+        int args[2] = {node.arg1, node.arg2};
+        for (int a = 0; a < min(arity(node.op), 2); ++a) {
+            int j = args[a];
+            Opcode fused = superinstruction(nodes[j].op, node.op);
+            if (fused == NUM_OPCODES || uses[j] != 1) { continue; }
+            auto it = p.bigrams.find({nodes[j].op, node.op});
+            if (it == p.bigrams.end() || it->second < threshold*size) { continue; }
+            const Instruction &producer = nodes[j];
+            if (fused == MULT_ADD || fused == PLUS3) {
+                node = {fused, producer.arg1, producer.arg2, args[1 - a], 0.00};
+            }
+            else if (fused == SCALED_MULT) {
+                node = {fused, producer.arg1, args[1 - a], -1, producer.constant};
+            }
+            else {
+                node = {fused, producer.arg1, producer.arg2, -1, node.constant};
+            }
+            removed[j] = true;
+            break;
+        }
+    }
+
+    // Renumber the nodes that were not removed
+    Program result;
+    vector<int> renumber(size, -1);
+    for (size_t k = 0; k < size; ++k) {
+        if (removed[k]) { continue; }
+        Instruction node = nodes[k];
+        int * args[3] = {&node.arg1, &node.arg2, &node.arg3};
+        for (int a = 0; a < arity(node.op); ++a) { *args[a] = renumber[*args[a]]; }
+        renumber[k] = (int) result.code.size();
+        result.code.push_back(node);
+    }
+    for (int i : program.independents) { result.independents.push_back(renumber[i]); }
+    for (int d : program.dependents) { result.dependents.push_back(renumber[d]); }
+    return result;
+
+}
+
+
+// Zero-order forward sweep (the values of the independents are set by the caller)
+void zos_sweep(const Program &program, double * v) {
+    const Instruction * nodes = program.code.data();
+    int size = (int) program.code.size();
+    for (int k = 0; k < size; ++k) {
+        const Instruction &N = nodes[k];
+        switch (N.op) {
+            case CONSTANT:   v[k] = N.constant; break;
+            case PLUS_A_A:   v[k] = v[N.arg1] + v[N.arg2]; break;
+            case MULT_A_A:   v[k] = v[N.arg1] * v[N.arg2]; break;
+            case MULT_D_A:   v[k] = N.constant * v[N.arg1]; break;
+            case EXP:        v[k] = exp(v[N.arg1]); break;
+            case SIN:        v[k] = sin(v[N.arg1]); break;
+            case COS:        v[k] = cos(v[N.arg1]); break;
+            case MULT_ADD:   v[k] = v[N.arg1] * v[N.arg2] + v[N.arg3]; break;
+            case PLUS3:      v[k] = v[N.arg1] + v[N.arg2] + v[N.arg3]; break;
+            case SCALED_MULT: v[k] = N.constant * v[N.arg1] * v[N.arg2]; break;
+            case SCALED_COS: v[k] = N.constant * cos(v[N.arg1]); break;
+            case SCALED_SIN: v[k] = N.constant * sin(v[N.arg1]); break;
+            case PLUS_SCALE: v[k] = N.constant * (v[N.arg1] + v[N.arg2]); break;
+            default: break;
+        }
+    }
+}
+
+// First-order forward sweep (the values and tangents of the independents are set by the caller)
+void fos_sweep(const Program &program, double * v, double * d) {
+    const Instruction * nodes = program.code.data();
+    int size = (int) program.code.size();
+    for (int k = 0; k < size; ++k) {
+        const Instruction &N = nodes[k];
+        switch (N.op) {
+            case CONSTANT:   v[k] = N.constant; d[k] = 0.00; break;
+            case PLUS_A_A:   v[k] = v[N.arg1] + v[N.arg2]; d[k] = d[N.arg1] + d[N.arg2]; break;
+            case MULT_A_A:   v[k] = v[N.arg1] * v[N.arg2]; d[k] = d[N.arg1]*v[N.arg2] + v[N.arg1]*d[N.arg2]; break;
+            case MULT_D_A:   v[k] = N.constant * v[N.arg1]; d[k] = N.constant * d[N.arg1]; break;
+            case EXP:        v[k] = exp(v[N.arg1]); d[k] = v[k] * d[N.arg1]; break;
+            case SIN:        v[k] = sin(v[N.arg1]); d[k] = cos(v[N.arg1]) * d[N.arg1]; break;
+            case COS:        v[k] = cos(v[N.arg1]); d[k] = -sin(v[N.arg1]) * d[N.arg1]; break;
+            case MULT_ADD:
+                v[k] = v[N.arg1] * v[N.arg2] + v[N.arg3];
+                d[k] = d[N.arg1]*v[N.arg2] + v[N.arg1]*d[N.arg2] + d[N.arg3];
+                break;
+            case PLUS3:
+                v[k] = v[N.arg1] + v[N.arg2] + v[N.arg3];
+                d[k] = d[N.arg1] + d[N.arg2] + d[N.arg3];
+                break;
+            case SCALED_MULT:
+                v[k] = N.constant * v[N.arg1] * v[N.arg2];
+                d[k] = N.constant * (d[N.arg1]*v[N.arg2] + v[N.arg1]*d[N.arg2]);
+                break;
+            case SCALED_COS:
+                v[k] = N.constant * cos(v[N.arg1]);
+                d[k] = -N.constant * sin(v[N.arg1]) * d[N.arg1];
+                break;
+            case SCALED_SIN:
+                v[k] = N.constant * sin(v[N.arg1]);
+                d[k] = N.constant * cos(v[N.arg1]) * d[N.arg1];
+                break;
+            case PLUS_SCALE:
+                v[k] = N.constant * (v[N.arg1] + v[N.arg2]);
+                d[k] = N.constant * (d[N.arg1] + d[N.arg2]);
+                break;
+            default: break;
+        }
+    }
+}
+
+// First-order reverse sweep with the values v of a previous forward sweep (the adjoints w are set by the caller)
+void fos_reverse_sweep(const Program &program, const double * v, double * w) {
+    const Instruction * nodes = program.code.data();
+    for (int k = (int) program.code.size() - 1; k >= 0; --k) {
+        const Instruction &N = nodes[k];
+        double a = w[k];
+        switch (N.op) {
+            case PLUS_A_A:   w[N.arg1] += a; w[N.arg2] += a; break;
+            case MULT_A_A:   w[N.arg1] += a*v[N.arg2]; w[N.arg2] += a*v[N.arg1]; break;
+            case MULT_D_A:   w[N.arg1] += N.constant*a; break;
+            case EXP:        w[N.arg1] += a*v[k]; break;
+            case SIN:        w[N.arg1] += a*cos(v[N.arg1]); break;
+            case COS:        w[N.arg1] -= a*sin(v[N.arg1]); break;
+            case MULT_ADD:   w[N.arg1] += a*v[N.arg2]; w[N.arg2] += a*v[N.arg1]; w[N.arg3] += a; break;
+            case PLUS3:      w[N.arg1] += a; w[N.arg2] += a; w[N.arg3] += a; break;
+            case SCALED_MULT: w[N.arg1] += N.constant*a*v[N.arg2]; w[N.arg2] += N.constant*a*v[N.arg1]; break;
+            case SCALED_COS: w[N.arg1] -= a*N.constant*sin(v[N.arg1]); break;
+            case SCALED_SIN: w[N.arg1] += a*N.constant*cos(v[N.arg1]); break;
+            case PLUS_SCALE: w[N.arg1] += N.constant*a; w[N.arg2] += N.constant*a; break;
+            default: break;
+        }
+    }
+}
+
+
+// Radius of the sphere
+static double R = 2.00;
+
+
+// Define the function to be differentiated: points of the sphere (u, v) = (x_i, x_{i+1}) as in demo_mimo_scalar, the
+// quadratic form of demo_miso_scalar evaluated at each point and the average of the quadratic forms
+template<typename T>
+T my_function(const T * x, int n) {
+    T sum = 0.00;
+    for (int i = 0; i < n-1; ++i) {
+        T f0 = R*cos(x[i])*cos(x[i+1]);
+        T f1 = R*sin(x[i])*cos(x[i+1]);
+        T f2 = R*sin(x[i+1]);
+        T q = f0*f0 + f2*f2 + 2*f0*f1 + f2;
+        sum = sum + q;
+    }
+    return sum/n;
+}
+
+
+// Time the three sweeps of a program and return the gradient
+void time_sweeps(const Program &program, const double * xp, int repetitions, double * times, vector<double> &gradient) {
+    size_t size = program.code.size();
+    int n = (int) program.independents.size();
+    vector<double> v(size), d(size), w(size);
+    for (int i = 0; i < n; ++i) {
+        v[program.independents[i]] = xp[i];
+        d[program.independents[i]] = 1.00;
+    }
+
+    auto t_start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < repetitions; ++r) { zos_sweep(program, v.data()); }
+    auto t_end = std::chrono::high_resolution_clock::now();
+    times[0] = std::chrono::duration<double>(t_end - t_start).count() / repetitions;
+
+    t_start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < repetitions; ++r) { fos_sweep(program, v.data(), d.data()); }
+    t_end = std::chrono::high_resolution_clock::now();
+    times[1] = std::chrono::duration<double>(t_end - t_start).count() / repetitions;
+
+    t_start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < repetitions; ++r) {
+        fill(w.begin(), w.end(), 0.00);
+        w[program.dependents[0]] = 1.00;
+        fos_reverse_sweep(program, v.data(), w.data());
+    }
+    t_end = std::chrono::high_resolution_clock::now();
+    times[2] = std::chrono::duration<double>(t_end - t_start).count() / repetitions;
+
+    gradient.resize(n);
+    for (int i = 0; i < n; ++i) { gradient[i] = w[program.independents[i]]; }
+}
+
+
+int main() {
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Initialize problem variables
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Number of independent variables, repetitions of each sweep and minimum frequency of a fused pair
+    int n = 100000, repetitions = 10;
+    double threshold = 0.01;
+    vector<double> xp(n);
+    for (int i = 0; i < n; ++i) { xp[i] = 0.50 + 0.25*sin(1.00*i); }
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Active section (expression graph)
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    Graph graph;
+    graph.begin();
+    vector<Var> x(n);
+    for (int i = 0; i < n; ++i) { x[i] <<= xp[i]; }
+    Var y = my_function(x.data(), n);
+    double yp;
+    y >>= yp;
+    graph.end();
+
+    // ADOL-C trace of the same function (reference for the gradient)
+    int tag = 0;
+    auto xa = new adouble[n];
+    adouble ya;
+    trace_on(tag);
+    for (int i = 0; i < n; ++i) { xa[i] <<= xp[i]; }
+    ya = my_function(xa, n);
+    ya >>= yp;
+    trace_off();
+    delete[] xa;
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Profile the graph and fuse the frequent pairs
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    Program original = compile(graph);
+    Profile p = profile(original);
+    Program fused = fuse(original, p, threshold);
+
+    // Sort the sequences by frequency
+    vector<pair<int, string>> bigrams, trigrams;
+    for (const auto &entry : p.bigrams) {
+        string name = string(opcode_names[entry.first.first]) + " > " + opcode_names[entry.first.second];
+        if (superinstruction((Opcode) entry.first.first, (Opcode) entry.first.second) != NUM_OPCODES) {
+            name += " (fused)";
+        }
+        bigrams.push_back({entry.second, name});
+    }
+    for (const auto &entry : p.trigrams) {
+        trigrams.push_back({entry.second, string(opcode_names[entry.first[0]]) + " > " + opcode_names[entry.first[1]]
+                                          + " > " + opcode_names[entry.first[2]]});
+    }
+    sort(bigrams.rbegin(), bigrams.rend());
+    sort(trigrams.rbegin(), trigrams.rend());
+
+    cout << "Most frequent sequences of " << graph.nodes.size() << " operations" << endl;
+    cout << setw(45) << "Pair" << setw(15) << "Count" << endl;
+    for (size_t k = 0; k < min(bigrams.size(), (size_t) 6); ++k) {
+        cout << setw(45) << bigrams[k].second << setw(15) << bigrams[k].first << endl;
+    }
+    cout << setw(45) << "Chain" << setw(15) << "Count" << endl;
+    for (size_t k = 0; k < min(trigrams.size(), (size_t) 4); ++k) {
+        cout << setw(45) << trigrams[k].second << setw(15) << trigrams[k].first << endl;
+    }
+    cout << endl;
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Time the sweeps of both programs
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    double times[2][3];
+    vector<double> g_original, g_fused;
+    time_sweeps(original, xp.data(), repetitions, times[0], g_original);
+    time_sweeps(fused, xp.data(), repetitions, times[1], g_fused);
+
+    vector<double> g_adolc(n);
+    gradient(tag, n, xp.data(), g_adolc.data());
+
+    double error = 0.00, error_adolc = 0.00;
+    for (int i = 0; i < n; ++i) {
+        error = fmax(error, fabs(g_original[i] - g_fused[i]));
+        error_adolc = fmax(error_adolc, fabs(g_fused[i] - g_adolc[i]));
+    }
+
+    const char * labels[2] = {"Original", "Superinstructions"};
+    cout.precision(8);
+    cout.setf(ios::fixed);
+    cout << setw(20) << "Program" << setw(15) << "Operations" << setw(20) << "zos [ms]" << setw(20) << "fos [ms]"
+         << setw(20) << "fos_reverse [ms]" << endl;
+    const Program * programs[2] = {&original, &fused};
+    for (int g = 0; g < 2; ++g) {
+        cout << setw(20) << labels[g] << setw(15) << programs[g]->code.size() << setw(20) << times[g][0]*1000
+             << setw(20) << times[g][1]*1000 << setw(20) << times[g][2]*1000 << endl;
+    }
+    cout << endl;
+    cout << "The maximum difference between the gradients of both programs is " << error << endl;
+    cout << "The maximum difference with the gradient of the ADOL-C trace is " << error_adolc << endl;
+    cout << endl << endl;
+
+
+
+    /* Observations:
+     *
+     *  The profile only counts the pairs where the intermediate result has a single use, because the result of a fused
+     *  producer is not stored and cannot be read by other operations
+     *  Each superinstruction removes one dispatch and one stored location. The fused kernels do the same arithmetic as
+     *  the separate kernels, so the gradients agree up to round-off
+     *  Each consumer is fused with at most one producer, so a chain such as PLUS_A_A > PLUS_A_A > PLUS_A_A becomes a
+     *  superinstruction followed by a normal operation. A kernel for a whole chain would remove one more dispatch
+     *  Pairs that do not reach the threshold are left unchanged, so rare patterns do not need their own kernels
+     *
+     * */
+
+    return 0;
+
+
+}
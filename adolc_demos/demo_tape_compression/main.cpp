@@ -0,0 +1,424 @@
+// ------------------------------------------------------------------------------------------------------------------ //
+// Example showing how compressible the operation, location and value streams of an ADOL-C trace are
+//
+// When a trace does not fit in the operation, location and value buffers, ADOL-C writes the three streams to the tape
+// files ADOLC-Operations_<tag>.tap, ADOLC-Locations_<tag>.tap and ADOLC-Values_<tag>.tap in the working directory.
+// The artificial delay loop of the demos produces 10^7 almost identical operations, so the three streams are highly
+// repetitive. This demo reads the streams and compresses them in independent blocks:
+//
+//  - Locations: difference with respect to the location s positions earlier (the stride s is selected for each block)
+//    followed by a variable-length encoding of the differences and a run-length encoding of the zero differences
+//  - Operations: the same scheme, where a run of zero differences is a run of a repeated pattern of s opcodes
+//  - Values: deduplicated constant pool plus a stream of pool indices compressed like the locations
+//
+// The blocks are decoded one at a time into a fixed-size buffer, which is how a sweep would read a compressed tape
+// (forward sweeps read the blocks in order and reverse sweeps in reverse order). The decoded streams are verified
+// against the original ones and the decoding time is compared with the time of a zos_forward sweep.
+//
+// ------------------------------------------------------------------------------------------------------------------ //
+
+
+// Include libraries
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <adolc/adolc.h>
+
+
+// Define namespaces
+using namespace std;                // cout, endl
+using namespace std::chrono;        // nanoseconds, system_clock, seconds
+
+
+// Default prefixes of the tape files written by ADOL-C (see FNAME1, FNAME2 and FNAME3 in usrparms.h)
+const string OPERATIONS_FILE = "ADOLC-Operations_";
+const string LOCATIONS_FILE = "ADOLC-Locations_";
+const string VALUES_FILE = "ADOLC-Values_";
+
+// The operations file starts with the version identifier and the tape statistics (ADOLC_ID and STAT_SIZE entries of
+// size_t in taping_p.h), and the opcodes of a trace go from start_of_tape to end_of_tape (OPCODES in oplate.h)
+struct AdolcId { char adolc_ver, adolc_sub, adolc_lvl, locint_size, revreal_size, address_size; };
+const size_t OPERATIONS_HEADER = sizeof(AdolcId) + STAT_SIZE*sizeof(size_t);
+const uint8_t END_OF_TAPE = 33, START_OF_TAPE = 34;
+
+// Number of elements of each compressed block and largest stride tried for the differences
+const size_t BLOCK_SIZE = 65536;
+const int MAX_STRIDE = 8;
+
+
+// Compressed stream made of independent blocks
+struct CompressedStream {
+    size_t size;                        // Number of elements of the original stream
+    vector<size_t> block_start;         // Position of each block in the byte array
+    vector<uint8_t> bytes;              // Encoded blocks
+    vector<double> pool;                // Constant pool (only used by the value stream)
+};
+
+
+// Read the elements of type T of a tape file that follow the first offset bytes (returns an empty vector if the file
+// does not exist). The files are written in whole buffers, so they can hold more elements than the tape statistics
+template<typename T>
+vector<T> read_tape_file(const string &name, size_t offset) {
+    vector<T> data;
+    ifstream file(name, ios::binary | ios::ate);
+    if (!file) { return data; }
+    size_t size = (size_t) file.tellg();
+    if (size <= offset) { return data; }
+    data.resize((size - offset)/sizeof(T));
+    file.seekg(offset);
+    file.read(reinterpret_cast<char *>(data.data()), data.size()*sizeof(T));
+    data.resize(file.gcount()/sizeof(T));
+    return data;
+}
+
+
+// Variable-length encoding of an unsigned integer (7 bits per byte, the high bit flags a continuation byte)
+inline void put_varint(vector<uint8_t> &out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t) (value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t) value);
+}
+
+inline uint64_t get_varint(const uint8_t *&in) {
+    uint64_t value = 0;
+    int shift = 0;
+    while (*in & 0x80) {
+        value |= (uint64_t) (*in++ & 0x7F) << shift;
+        shift += 7;
+    }
+    value |= (uint64_t) (*in++) << shift;
+    return value;
+}
+
+
+// Map signed differences to unsigned integers (0, -1, 1, -2, 2, ... -> 0, 1, 2, 3, 4, ...)
+inline uint64_t zigzag(int64_t value) { return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63); }
+inline int64_t unzigzag(uint64_t value) { return (int64_t) (value >> 1) ^ -(int64_t) (value & 1); }
+
+
+// Encode the differences v[i] - v[i-stride] of a block. A zero difference starts a run encoded as 0 plus the run
+// length, any other difference is encoded as its (nonzero) zigzag value
+void encode_differences(const uint32_t *v, size_t count, int stride, vector<uint8_t> &out) {
+    size_t i = 0;
+    while (i < count) {
+        int64_t previous = (i >= (size_t) stride) ? v[i-stride] : 0;
+        int64_t difference = (int64_t) v[i] - previous;
+        if (difference != 0) {
+            put_varint(out, zigzag(difference));
+            ++i;
+            continue;
+        }
+        size_t run = 1;
+        while (i + run < count && i + run >= (size_t) stride && v[i+run] == v[i+run-stride]) { ++run; }
+        put_varint(out, 0);
+        put_varint(out, run-1);
+        i += run;
+    }
+}
+
+void decode_differences(const uint8_t *&in, size_t count, int stride, uint32_t *v) {
+    size_t i = 0;
+    while (i < count) {
+        uint64_t token = get_varint(in);
+        if (token != 0) {
+            int64_t previous = (i >= (size_t) stride) ? v[i-stride] : 0;
+            v[i] = (uint32_t) (previous + unzigzag(token));
+            ++i;
+            continue;
+        }
+        size_t run = get_varint(in) + 1;
+        for (size_t k = 0; k < run; ++k, ++i) {
+            v[i] = (i >= (size_t) stride) ? v[i-stride] : 0;
+        }
+    }
+}
+
+
+// Compress a stream of unsigned integers (locations or constant pool indices) selecting the best stride per block
+CompressedStream compress_integers(const vector<uint32_t> &data) {
+    CompressedStream stream;
+    stream.size = data.size();
+    vector<uint8_t> best, candidate;
+    for (size_t start = 0; start < data.size(); start += BLOCK_SIZE) {
+        size_t count = min(BLOCK_SIZE, data.size() - start);
+        int best_stride = 1;
+        best.clear();
+        encode_differences(&data[start], count, 1, best);
+        for (int stride = 2; stride <= MAX_STRIDE; ++stride) {
+            candidate.clear();
+            encode_differences(&data[start], count, stride, candidate);
+            if (candidate.size() < best.size()) { swap(best, candidate); best_stride = stride; }
+        }
+        stream.block_start.push_back(stream.bytes.size());
+        stream.bytes.push_back((uint8_t) best_stride);
+        stream.bytes.insert(stream.bytes.end(), best.begin(), best.end());
+    }
+    return stream;
+}
+
+size_t decode_integer_block(const CompressedStream &stream, size_t block, uint32_t *out) {
+    size_t count = min(BLOCK_SIZE, stream.size - block*BLOCK_SIZE);
+    const uint8_t *in = &stream.bytes[stream.block_start[block]];
+    int stride = *in++;
+    decode_differences(in, count, stride, out);
+    return count;
+}
+
+
+// Compress the opcodes with the same scheme: a run of zero differences with stride s is a run of a repeated pattern
+// of s opcodes (the delay loop alternates between two opcodes, so the plain run length would always be one)
+CompressedStream compress_operations(const vector<uint8_t> &data) {
+    vector<uint32_t> wide(data.begin(), data.end());
+    return compress_integers(wide);
+}
+
+size_t decode_operation_block(const CompressedStream &stream, size_t block, uint32_t *work, uint8_t *out) {
+    size_t count = decode_integer_block(stream, block, work);
+    for (size_t i = 0; i < count; ++i) { out[i] = (uint8_t) work[i]; }
+    return count;
+}
+
+
+// Compress the values by deduplicating them into a constant pool and compressing the stream of pool indices
+CompressedStream compress_values(const vector<double> &data) {
+    unordered_map<uint64_t, uint32_t> position;
+    vector<double> pool;
+    vector<uint32_t> indices(data.size());
+    for (size_t i = 0; i < data.size(); ++i) {
+        uint64_t bits;
+        memcpy(&bits, &data[i], sizeof(double));    // Compare the bit patterns (keeps -0.0 and NaN payloads)
+        auto found = position.find(bits);
+        if (found == position.end()) {
+            found = position.emplace(bits, (uint32_t) pool.size()).first;
+            pool.push_back(data[i]);
+        }
+        indices[i] = found->second;
+    }
+    CompressedStream stream = compress_integers(indices);
+    stream.pool = pool;
+    return stream;
+}
+
+size_t decode_value_block(const CompressedStream &stream, size_t block, uint32_t *work, double *out) {
+    size_t count = decode_integer_block(stream, block, work);
+    for (size_t i = 0; i < count; ++i) { out[i] = stream.pool[work[i]]; }
+    return count;
+}
+
+
+// Size of a stream in megabytes
+double megabytes(size_t bytes) { return bytes / 1024.0 / 1024.0; }
+
+
+// Define the function to be differentiated: f(x) = e^[(x0+x1+...+xn)/n]
+adouble my_function(adouble * x, int n) {
+    adouble sum;
+    for (int i = 0; i < n; ++i) {
+        sum += x[i];
+    }
+    adouble f = exp(sum/n);
+    return f;
+};
+
+
+int main() {
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Initialize problem variables
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Initialize passive variables
+    int m = 1, n = 50;          // Set n equal to the desired number of independent variables
+    auto xp = new double[n];    // Independent vector
+    auto yp = new double[m];    // Dependent vector
+
+    // Set the value of the independent variables
+    for (int i = 0; i < n; ++i) {
+        xp[i] = 1.;
+    }
+
+    // Initialize active variables
+    auto x = new adouble[n];
+    auto y = new adouble[m];
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Active section for automatic differentiation
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Set the tag for the Automatic Differentiation trace
+    int tag = 0;
+
+    // Start tracing floating point operations
+    trace_on(tag);  // Start of the active section
+
+    // Assign independent variables
+    for (int i = 0; i < n; ++i) {
+        x[i] <<= xp[i];
+    }
+
+    // Add an artificial delay by performing floating point operations that do not change the result
+    // These 10^7 operations do not fit in the default buffers, so ADOL-C writes the trace to the tape files
+    for (int j = 0; j < 1e7; ++j) {x[0] = x[0] + 0*j;}
+
+    // Evaluate the body of the differentiated code
+    y[0] = my_function(x, n);
+
+    // Assign dependent variables
+    y[0] >>= yp[0];
+
+    trace_off();    // End of the active section
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Read the operation, location and value streams
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Get the size of the streams
+    size_t counts[STAT_SIZE];
+    tapestats(tag, counts);
+    cout << "Number of operations: " << counts[NUM_OPERATIONS] << endl;
+    cout << "Number of locations:  " << counts[NUM_LOCATIONS] << endl;
+    cout << "Number of values:     " << counts[NUM_VALUES] << endl;
+    cout << endl;
+
+    // The streams are only available if the trace was written to the tape files
+    if (counts[OP_FILE_ACCESS] == 0 || counts[LOC_FILE_ACCESS] == 0 || counts[VAL_FILE_ACCESS] == 0) {
+        cout << "The trace fits in the ADOL-C buffers and was not written to the tape files" << endl;
+        cout << "Reduce OBUFSIZE, LBUFSIZE and VBUFSIZE in the .adolcrc file to write the tape files" << endl;
+        return 0;
+    }
+    string suffix = to_string(tag) + ".tap";
+    auto operations = read_tape_file<uint8_t>(OPERATIONS_FILE + suffix, OPERATIONS_HEADER);
+    auto locations = read_tape_file<uint32_t>(LOCATIONS_FILE + suffix, 0);
+    auto values = read_tape_file<double>(VALUES_FILE + suffix, 0);
+    if (operations.empty() || locations.empty()) {
+        cout << "The tape files could not be read from the working directory" << endl;
+        return 0;
+    }
+
+    // A stream read from the wrong position does not start and end with the markers of the trace
+    bool framed = operations.front() == START_OF_TAPE && operations.back() == END_OF_TAPE;
+    if (!framed) {
+        cout << "The operations file does not go from start_of_tape to end_of_tape" << endl;
+    }
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Compress the streams
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    auto t_start = std::chrono::high_resolution_clock::now();
+    CompressedStream compressed_operations = compress_operations(operations);
+    CompressedStream compressed_locations = compress_integers(locations);
+    CompressedStream compressed_values = compress_values(values);
+    auto t_end = std::chrono::high_resolution_clock::now();
+    double time_compression = std::chrono::duration<double>(t_end - t_start).count();
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Decode the streams block by block and verify them
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Fixed-size buffers (the same size as one block), as a sweep would use them
+    auto op_buffer = new uint8_t[BLOCK_SIZE];
+    auto loc_buffer = new uint32_t[BLOCK_SIZE];
+    auto val_buffer = new double[BLOCK_SIZE];
+    auto index_buffer = new uint32_t[BLOCK_SIZE];
+    bool valid = framed;
+
+    // Operations
+    t_start = std::chrono::high_resolution_clock::now();
+    for (size_t block = 0; block < compressed_operations.block_start.size(); ++block) {
+        size_t count = decode_operation_block(compressed_operations, block, index_buffer, op_buffer);
+        valid = valid && memcmp(op_buffer, &operations[block*BLOCK_SIZE], count*sizeof(uint8_t)) == 0;
+    }
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_operations = std::chrono::duration<double>(t_end - t_start).count();
+
+    // Locations
+    t_start = std::chrono::high_resolution_clock::now();
+    for (size_t block = 0; block < compressed_locations.block_start.size(); ++block) {
+        size_t count = decode_integer_block(compressed_locations, block, loc_buffer);
+        valid = valid && memcmp(loc_buffer, &locations[block*BLOCK_SIZE], count*sizeof(uint32_t)) == 0;
+    }
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_locations = std::chrono::duration<double>(t_end - t_start).count();
+
+    // Values
+    t_start = std::chrono::high_resolution_clock::now();
+    for (size_t block = 0; block < compressed_values.block_start.size(); ++block) {
+        size_t count = decode_value_block(compressed_values, block, index_buffer, val_buffer);
+        valid = valid && memcmp(val_buffer, &values[block*BLOCK_SIZE], count*sizeof(double)) == 0;
+    }
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_values = std::chrono::duration<double>(t_end - t_start).count();
+
+    // Time a zos_forward sweep for comparison
+    t_start = std::chrono::high_resolution_clock::now();
+    zos_forward(tag, m, n, 0, xp, yp);
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_zos = std::chrono::duration<double>(t_end - t_start).count();
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Print the results
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    size_t pool_bytes = compressed_values.pool.size()*sizeof(double);
+    cout.precision(3);
+    cout.setf(ios::fixed);
+    cout << "Compression of the trace streams (blocks of " << BLOCK_SIZE << " elements)" << endl;
+    cout << setw(15) << "Stream" << setw(18) << "Original [MB]" << setw(20) << "Compressed [MB]"
+         << setw(12) << "Ratio" << setw(20) << "Decoding [ms]" << endl;
+    cout << setw(15) << "Operations" << setw(18) << megabytes(operations.size()*sizeof(uint8_t))
+         << setw(20) << megabytes(compressed_operations.bytes.size())
+         << setw(12) << (double) operations.size()*sizeof(uint8_t) / compressed_operations.bytes.size()
+         << setw(20) << time_operations*1000 << endl;
+    cout << setw(15) << "Locations" << setw(18) << megabytes(locations.size()*sizeof(uint32_t))
+         << setw(20) << megabytes(compressed_locations.bytes.size())
+         << setw(12) << (double) locations.size()*sizeof(uint32_t) / compressed_locations.bytes.size()
+         << setw(20) << time_locations*1000 << endl;
+    cout << setw(15) << "Values" << setw(18) << megabytes(values.size()*sizeof(double))
+         << setw(20) << megabytes(compressed_values.bytes.size() + pool_bytes)
+         << setw(12) << (double) values.size()*sizeof(double) / (compressed_values.bytes.size() + pool_bytes)
+         << setw(20) << time_values*1000 << endl;
+    cout << endl;
+    cout << "Number of distinct values in the constant pool: " << compressed_values.pool.size() << endl;
+    cout << "The decoded streams are " << (valid ? "identical to" : "DIFFERENT from") << " the original streams" << endl;
+    cout << "The elapsed time of the compression was " << time_compression*1000 << " milliseconds" << endl;
+    cout << "The elapsed time of the decoding was " << (time_operations + time_locations + time_values)*1000
+         << " milliseconds" << endl;
+    cout << "The elapsed time of a zos_forward sweep was " << time_zos*1000 << " milliseconds" << endl;
+    cout << endl << endl;
+
+
+
+    /* Observations:
+     *
+     *  The repetitive delay loop compresses by more than an order of magnitude
+     *  The blocks are independent, so they can be decoded in any order (forward or reverse sweeps)
+     *  Decoding the blocks is cheaper than the zos_forward sweep itself, so a sweep reading the compressed
+     *  streams would not be slowed down significantly
+     *
+     * */
+
+    return 0;
+
+
+}
@@ -0,0 +1,365 @@
+// ------------------------------------------------------------------------------------------------------------------ //
+// Example showing how to hide the I/O stalls of reading a large tape backwards with a prefetching reader
+//
+// When a trace does not fit in the buffers, ADOL-C writes it to the tape files ADOLC-Operations_<tag>.tap,
+// ADOLC-Locations_<tag>.tap and ADOLC-Values_<tag>.tap and the reverse sweeps read these files backwards, one buffer
+// at a time. If the next buffer is only read when the current one is exhausted, every refill stalls the sweep.
+// This demo implements a double-buffered reader that reads the files in reverse block order with a background thread:
+// while the sweep processes the current block, the thread reads the previous block of the file into the second
+// buffer. The time the sweep waits for data (stall time) is compared with a synchronous reader.
+//
+// The processing of each block is a stand-in for the reverse sweep (it traverses the block backwards and updates a
+// small adjoint array). Before each measurement the tape files are flushed to the disk and their cached pages are
+// discarded with posix_fadvise() when it is available, so that the reads come from the disk. The fraction of the
+// pages that remained in the page cache is measured with mincore() and printed next to the times.
+//
+// ------------------------------------------------------------------------------------------------------------------ //
+
+
+// Include libraries
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <adolc/adolc.h>
+
+
+// Define namespaces
+using namespace std;                // cout, endl
+using namespace std::chrono;        // nanoseconds, system_clock, seconds
+
+
+// Default prefixes of the tape files written by ADOL-C (see FNAME1, FNAME2 and FNAME3 in usrparms.h)
+const string OPERATIONS_FILE = "ADOLC-Operations_";
+const string LOCATIONS_FILE = "ADOLC-Locations_";
+const string VALUES_FILE = "ADOLC-Values_";
+
+// Size of the blocks read from the tape files (in bytes)
+const size_t BLOCK_SIZE = 4 << 20;
+
+
+// Reader that returns the blocks of a file in reverse order. With prefetch enabled, a background thread reads the
+// next block into a second buffer while the caller processes the current one (double buffering)
+class ReverseBlockReader {
+
+public:
+
+    ReverseBlockReader(const string &name, bool prefetch) : prefetch(prefetch) {
+        fd = open(name.c_str(), O_RDONLY);
+        struct stat info;
+        file_size = (fd >= 0 && fstat(fd, &info) == 0) ? info.st_size : 0;
+        num_blocks = (file_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        for (int k = 0; k < 2; ++k) {
+            buffer[k].resize(BLOCK_SIZE);
+            size[k] = 0;
+            ready[k] = false;
+        }
+        if (prefetch && num_blocks > 0) { worker = thread(&ReverseBlockReader::read_all, this); }
+    }
+
+    ~ReverseBlockReader() {
+        {
+            lock_guard<mutex> lock(guard);
+            stop = true;
+        }
+        changed.notify_all();
+        if (worker.joinable()) { worker.join(); }
+        if (fd >= 0) { close(fd); }
+    }
+
+    bool is_open() const { return fd >= 0; }
+
+    // Return the next block in reverse order (nullptr after the first block of the file). The block remains valid
+    // until the following call
+    const char * next(size_t &bytes) {
+        if (consumed == num_blocks) { bytes = 0; return nullptr; }
+        auto t_start = std::chrono::high_resolution_clock::now();
+        int slot = consumed % 2;
+        if (prefetch) {
+            unique_lock<mutex> lock(guard);
+            if (consumed > 0) { ready[1 - slot] = false; }      // Release the block returned by the previous call
+            changed.notify_all();
+            changed.wait(lock, [&]() { return ready[slot]; });
+        } else {
+            read_block(num_blocks - 1 - consumed, slot);
+        }
+        auto t_end = std::chrono::high_resolution_clock::now();
+        stall += std::chrono::duration<double>(t_end - t_start).count();
+        ++consumed;
+        bytes = size[slot];
+        return buffer[slot].data();
+    }
+
+    // Time spent waiting for data in next()
+    double stall_time() const { return stall; }
+
+private:
+
+    // Read the block with the given index into one of the two buffers
+    void read_block(size_t index, int slot) {
+        size_t offset = index*BLOCK_SIZE;
+        size_t bytes = min(BLOCK_SIZE, file_size - offset);
+        size_t done = 0;
+        while (done < bytes) {
+            ssize_t count = pread(fd, buffer[slot].data() + done, bytes - done, offset + done);
+            if (count <= 0) { break; }
+            done += count;
+        }
+        size[slot] = done;
+    }
+
+    // Background thread: read the blocks from the end of the file alternating between the two buffers
+    void read_all() {
+        for (size_t k = 0; k < num_blocks; ++k) {
+            int slot = k % 2;
+            {
+                unique_lock<mutex> lock(guard);
+                changed.wait(lock, [&]() { return stop || !ready[slot]; });
+                if (stop) { return; }
+            }
+            read_block(num_blocks - 1 - k, slot);
+            {
+                lock_guard<mutex> lock(guard);
+                ready[slot] = true;
+            }
+            changed.notify_all();
+        }
+    }
+
+    int fd;
+    bool prefetch;
+    size_t file_size, num_blocks, consumed = 0;
+    vector<char> buffer[2];
+    size_t size[2];
+    bool ready[2];
+    bool stop = false;
+    double stall = 0.00;
+    thread worker;
+    mutex guard;
+    condition_variable changed;
+
+};
+
+
+// Discard the cached pages of a file so that the next read comes from the disk (when supported). The tape files were
+// just written and POSIX_FADV_DONTNEED does not discard dirty pages, so the file is written back first. Returns the
+// number of pages of the file that are still cached, or -1 if it cannot be measured
+long drop_page_cache(const string &name, long &pages) {
+    pages = 0;
+    int fd = open(name.c_str(), O_RDONLY);
+    if (fd < 0) { return -1; }
+#ifdef POSIX_FADV_DONTNEED
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+    long cached = -1;
+    struct stat info;
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        size_t length = (size_t) info.st_size;
+        pages = (long) ((length + page_size - 1) / page_size);
+        void * map = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        if (map != MAP_FAILED) {
+            vector<unsigned char> resident(pages);
+            if (mincore(map, length, resident.data()) == 0) {
+                cached = 0;
+                for (unsigned char r : resident) { cached += r & 1; }
+            }
+            munmap(map, length);
+        }
+    }
+    close(fd);
+    return cached;
+}
+
+
+// Stand-in for the reverse sweep: traverse the block backwards and update a small adjoint array
+double process_block(const char * data, size_t bytes, double * adjoints) {
+    const uint8_t * byte = reinterpret_cast<const uint8_t *>(data);
+    for (size_t i = bytes; i > 0; --i) {
+        double &a = adjoints[byte[i-1] % 64];
+        a = 0.50*a + sqrt(1.00 + byte[i-1]);
+    }
+    return adjoints[0];
+}
+
+
+// Read the three tape files backwards and return the total time, the stall time, a checksum and the fraction of the
+// pages of the files that were still cached when the reading started (negative if it cannot be measured)
+void reverse_read(const vector<string> &files, bool prefetch, double &time, double &stall, double &checksum,
+                  double &cached) {
+    long cached_pages = 0, total_pages = 0;
+    for (const string &name : files) {
+        long pages;
+        long still_cached = drop_page_cache(name, pages);
+        cached_pages = (still_cached < 0 || cached_pages < 0) ? -1 : cached_pages + still_cached;
+        total_pages += pages;
+    }
+    cached = (cached_pages < 0 || total_pages == 0) ? -1.00 : (double) cached_pages / total_pages;
+    double adjoints[64] = {0.00};
+    time = stall = checksum = 0.00;
+    auto t_start = std::chrono::high_resolution_clock::now();
+    for (const string &name : files) {
+        ReverseBlockReader reader(name, prefetch);
+        size_t bytes;
+        while (const char * block = reader.next(bytes)) {
+            checksum += process_block(block, bytes, adjoints);
+        }
+        stall += reader.stall_time();
+    }
+    auto t_end = std::chrono::high_resolution_clock::now();
+    time = std::chrono::duration<double>(t_end - t_start).count();
+}
+
+
+// Define the function to be differentiated: f(x) = e^[(x0+x1+...+xn)/n]
+adouble my_function(adouble * x, int n) {
+    adouble sum;
+    for (int i = 0; i < n; ++i) {
+        sum += x[i];
+    }
+    adouble f = exp(sum/n);
+    return f;
+};
+
+
+int main() {
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Initialize problem variables
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Initialize passive variables
+    int m = 1, n = 50;          // Set n equal to the desired number of independent variables
+    auto xp = new double[n];    // Independent vector
+    auto yp = new double[m];    // Dependent vector
+
+    // Set the value of the independent variables
+    for (int i = 0; i < n; ++i) {
+        xp[i] = 1.;
+    }
+
+    // Initialize active variables
+    auto x = new adouble[n];
+    auto y = new adouble[m];
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Active section for automatic differentiation
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Set the tag for the Automatic Differentiation trace
+    int tag = 0;
+
+    // Start tracing floating point operations
+    trace_on(tag);  // Start of the active section
+
+    // Assign independent variables
+    for (int i = 0; i < n; ++i) {
+        x[i] <<= xp[i];
+    }
+
+    // Add an artificial delay by performing floating point operations that do not change the result
+    // These 10^7 operations do not fit in the default buffers, so ADOL-C writes the trace to the tape files
+    for (int j = 0; j < 1e7; ++j) {x[0] = x[0] + 0*j;}
+
+    // Evaluate the body of the differentiated code
+    y[0] = my_function(x, n);
+
+    // Assign dependent variables
+    y[0] >>= yp[0];
+
+    trace_off();    // End of the active section
+
+    // The tape files are only written if the trace does not fit in the buffers
+    size_t counts[STAT_SIZE];
+    tapestats(tag, counts);
+    if (counts[OP_FILE_ACCESS] == 0) {
+        cout << "The trace fits in the ADOL-C buffers and was not written to the tape files" << endl;
+        cout << "Reduce OBUFSIZE, LBUFSIZE and VBUFSIZE in the .adolcrc file to write the tape files" << endl;
+        return 0;
+    }
+    string suffix = to_string(tag) + ".tap";
+    vector<string> files = {OPERATIONS_FILE + suffix, LOCATIONS_FILE + suffix, VALUES_FILE + suffix};
+    if (!ReverseBlockReader(files[0], false).is_open()) {
+        cout << "The tape files could not be read from the working directory" << endl;
+        return 0;
+    }
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Read the tape backwards with the synchronous and the prefetching readers
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    double time_sync, stall_sync, checksum_sync, cached_sync;
+    reverse_read(files, false, time_sync, stall_sync, checksum_sync, cached_sync);
+
+    double time_prefetch, stall_prefetch, checksum_prefetch, cached_prefetch;
+    reverse_read(files, true, time_prefetch, stall_prefetch, checksum_prefetch, cached_prefetch);
+
+    // Time the reverse sweep of ADOL-C for comparison
+    auto u = new double[m];
+    auto z = new double[n];
+    u[0] = 1.00;
+    zos_forward(tag, m, n, 1, xp, yp);
+    auto t_start = std::chrono::high_resolution_clock::now();
+    fos_reverse(tag, m, n, u, z);
+    auto t_end = std::chrono::high_resolution_clock::now();
+    double time_reverse = std::chrono::duration<double>(t_end - t_start).count();
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Print the results
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    cout.precision(3);
+    cout.setf(ios::fixed);
+    cout << "Reverse traversal of the tape files (blocks of " << BLOCK_SIZE/(1 << 20) << " MB)" << endl;
+    cout << setw(20) << "Reader" << setw(20) << "Total time [ms]" << setw(20) << "Stall time [ms]"
+         << setw(20) << "Checksum" << setw(20) << "Cached pages [%]" << endl;
+    cout << setw(20) << "Synchronous" << setw(20) << time_sync*1000 << setw(20) << stall_sync*1000
+         << setw(20) << checksum_sync << setw(20) << cached_sync*100 << endl;
+    cout << setw(20) << "Prefetching" << setw(20) << time_prefetch*1000 << setw(20) << stall_prefetch*1000
+         << setw(20) << checksum_prefetch << setw(20) << cached_prefetch*100 << endl;
+    cout << endl;
+    if (cached_sync < 0 || cached_prefetch < 0) {
+        cout << "The page cache could not be inspected, the files may have been read from memory" << endl;
+    } else if (cached_sync > 0.10 || cached_prefetch > 0.10) {
+        cout << "Part of the tape files stayed in the page cache, the stall times underestimate a cold read" << endl;
+    }
+    cout << "The elapsed time of the fos_reverse sweep was " << time_reverse*1000 << " milliseconds" << endl;
+    cout << endl << endl;
+
+
+
+    /* Observations:
+     *
+     *  The synchronous reader stalls for every block, the prefetching reader only stalls for the first block of each
+     *  file and whenever reading a block takes longer than processing the previous one
+     *  Both readers return the same blocks in the same order, so the checksums are identical
+     *  The cached pages column shows whether the files were actually evicted before each measurement. With a nearly
+     *  empty page cache the stalls of the synchronous reader are disk reads, otherwise they are memory copies
+     *  If the whole trace fits in memory, increasing OBUFSIZE, LBUFSIZE, VBUFSIZE and TBUFSIZE in the .adolcrc file
+     *  avoids the tape files altogether
+     *
+     * */
+
+    return 0;
+
+
+}
@@ -0,0 +1,259 @@
+// ------------------------------------------------------------------------------------------------------------------ //
+// Example showing how to change the constants of a model without retaping by recording them as taped parameters
+//
+// The constants of the model (radius and height of the center of a sphere) are created with mkparam() inside the
+// active section. ADOL-C stores them in the parameter store of the trace instead of writing their values into the
+// trace as literal constants, so their values can be replaced between sweeps with set_param_vec() and the next
+// forward or reverse sweep uses the new values. The parameters are numbered in the order in which they are created.
+//
+// The parameters are not independent variables of the trace, so the drivers only return derivatives with respect to
+// the independent variables. When the derivatives with respect to the parameters are requested, a second trace where
+// the parameters are additional independent variables is recorded (only once, at the first request) and its Jacobian
+// columns of the parameters are returned. This trace does not need to be updated when the parameters change because
+// their values are inputs of the sweep.
+//
+// ------------------------------------------------------------------------------------------------------------------ //
+
+
+// Include libraries
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <adolc/adolc.h>
+
+
+// Define namespaces
+using namespace std;                // cout, endl
+using namespace std::chrono;        // nanoseconds, system_clock, seconds
+
+
+// Number of dependent variables, independent variables and parameters
+const int M = 3, N = 2, NP = 2;
+
+
+// Define the function to be differentiated: sphere of radius R centered at (0, 0, z0)
+// The type P of the constants is pdouble (taped parameters), adouble (parameters as independent variables) or double
+template<typename P>
+void my_function(const adouble * x, const P &R, const P &z0, adouble * f) {
+    f[0] = R*(cos(x[0])*cos(x[1]));
+    f[1] = R*(sin(x[0])*cos(x[1]));
+    f[2] = z0 + R*sin(x[1]);
+}
+
+
+// Model with taped parameters: the parameters are updated in place and the derivatives with respect to them are
+// computed on demand from a second trace that is recorded the first time they are requested
+class ParametricModel {
+
+public:
+
+    ParametricModel(short tag, short tag_parameters, const double * x, const double * parameters)
+            : tag(tag), tag_parameters(tag_parameters) {
+        for (int k = 0; k < NP; ++k) { p[k] = parameters[k]; }
+        record(x);
+    }
+
+    // Update the value of the parameter k (0: radius, 1: height of the center) without retaping
+    void set_parameter(int k, double value) {
+        p[k] = value;
+        set_param_vec(tag, NP, p);
+    }
+
+    double parameter(int k) const { return p[k]; }
+
+    // Jacobian with respect to the independent variables at x
+    void jacobian_x(const double * x, double ** J) { jacobian(tag, M, N, x, J); }
+
+    // Jacobian with respect to the parameters at x (M x NP)
+    void jacobian_p(const double * x, double ** Jp) {
+        if (!traced_parameters) { record_parameters(x); }
+        double xp[N + NP], J[M][N + NP], * rows[M];
+        for (int i = 0; i < N; ++i) { xp[i] = x[i]; }
+        for (int k = 0; k < NP; ++k) { xp[N + k] = p[k]; }
+        for (int i = 0; i < M; ++i) { rows[i] = J[i]; }
+        jacobian(tag_parameters, M, N + NP, xp, rows);
+        for (int i = 0; i < M; ++i) {
+            for (int k = 0; k < NP; ++k) { Jp[i][k] = J[i][N + k]; }
+        }
+    }
+
+    // Number of traces recorded by the model
+    int retapes() const { return count; }
+
+private:
+
+    // Record the model with the constants as taped parameters
+    void record(const double * x) {
+        adouble xa[N], fa[M];
+        double fp[M];
+        trace_on(tag);
+        for (int i = 0; i < N; ++i) { xa[i] <<= x[i]; }
+        pdouble R = mkparam(p[0]);
+        pdouble z0 = mkparam(p[1]);
+        my_function(xa, R, z0, fa);
+        for (int i = 0; i < M; ++i) { fa[i] >>= fp[i]; }
+        trace_off();
+        ++count;
+    }
+
+    // Record the model with the constants as additional independent variables
+    void record_parameters(const double * x) {
+        adouble xa[N], pa[NP], fa[M];
+        double fp[M];
+        trace_on(tag_parameters);
+        for (int i = 0; i < N; ++i) { xa[i] <<= x[i]; }
+        for (int k = 0; k < NP; ++k) { pa[k] <<= p[k]; }
+        my_function(xa, pa[0], pa[1], fa);
+        for (int i = 0; i < M; ++i) { fa[i] >>= fp[i]; }
+        trace_off();
+        ++count;
+        traced_parameters = true;
+    }
+
+    short tag, tag_parameters;
+    double p[NP];
+    bool traced_parameters = false;
+    int count = 0;
+
+};
+
+
+// Record the model with the constants written into the trace (as in demo_mimo_scalar)
+void record_constants(short tag, const double * x, double R, double z0) {
+    adouble xa[N], fa[M];
+    double fp[M];
+    trace_on(tag);
+    for (int i = 0; i < N; ++i) { xa[i] <<= x[i]; }
+    my_function(xa, R, z0, fa);
+    for (int i = 0; i < M; ++i) { fa[i] >>= fp[i]; }
+    trace_off();
+}
+
+
+int main() {
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Initialize problem variables
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Point of the sphere and initial value of the parameters
+    double u = 0.50, v = 0.25;
+    double xp[N] = {u, v};
+    double parameters[NP] = {2.00, 0.00};
+
+    // Values of the radius of the parameter sweep
+    int samples = 10000;
+    double R_min = 1.00, R_max = 3.00;
+
+    // Jacobians of the sweep
+    auto J = myalloc2(M, N);
+    auto J_retape = myalloc2(M, N);
+    auto Jp = myalloc2(M, NP);
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Active section for automatic differentiation (constants as taped parameters)
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Set the tags for the Automatic Differentiation traces
+    short tag = 0, tag_parameters = 1, tag_retape = 2;
+
+    // Record the trace once
+    ParametricModel model(tag, tag_parameters, xp, parameters);
+
+    size_t tape_stats[STAT_SIZE];
+    tapestats(tag, tape_stats);
+    cout << "Number of taped parameters: " << tape_stats[NUM_PARAM] << endl;
+    cout << endl;
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Parameter sweep of the Jacobian with respect to the independent variables
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Update the taped parameter and reuse the trace
+    double error = 0.00;
+    auto t_start = std::chrono::high_resolution_clock::now();
+    for (int s = 0; s < samples; ++s) {
+        double R = R_min + (R_max - R_min)*s/(samples - 1);
+        model.set_parameter(0, R);
+        model.jacobian_x(xp, J);
+        error = fmax(error, fabs(J[2][1] - R*cos(v)));
+    }
+    auto t_end = std::chrono::high_resolution_clock::now();
+    double time_parameters = std::chrono::duration<double>(t_end - t_start).count();
+
+    // Retape the model with the constant written into the trace for each value
+    double difference = 0.00;
+    t_start = std::chrono::high_resolution_clock::now();
+    for (int s = 0; s < samples; ++s) {
+        double R = R_min + (R_max - R_min)*s/(samples - 1);
+        record_constants(tag_retape, xp, R, model.parameter(1));
+        jacobian(tag_retape, M, N, xp, J_retape);
+        if (s == samples - 1) {
+            for (int i = 0; i < M; ++i) {
+                for (int j = 0; j < N; ++j) { difference = fmax(difference, fabs(J[i][j] - J_retape[i][j])); }
+            }
+        }
+    }
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_retape = std::chrono::duration<double>(t_end - t_start).count();
+
+    cout << "Parameter sweep of the Jacobian (" << samples << " values of the radius)" << endl;
+    cout << setw(20) << "Method" << setw(20) << "Traces" << setw(20) << "Time [ms]" << endl;
+    cout.precision(8);
+    cout.setf(ios::fixed);
+    cout << setw(20) << "Taped parameters" << setw(20) << model.retapes() << setw(20) << time_parameters*1000 << endl;
+    cout << setw(20) << "Retape" << setw(20) << samples << setw(20) << time_retape*1000 << endl;
+    cout << endl;
+    cout << "The maximum error of dzdv with respect to the analytic derivative is " << error << endl;
+    cout << "The maximum difference between both Jacobians is " << difference << endl;
+    cout << endl << endl;
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Compute the derivatives with respect to the parameters (on demand)
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    model.set_parameter(0, 2.50);
+    model.set_parameter(1, 0.75);
+    model.jacobian_p(xp, Jp);
+
+    cout << "Derivatives with respect to the parameters (R = " << model.parameter(0) << ", z0 = " << model.parameter(1) << ")" << endl;
+    cout << setw(20) << "Component" << setw(20) << "AD derivative" << setw(25) << "Analytic derivative" << endl;
+    cout << setw(20) << "dxdR" << setw(20) << Jp[0][0] << setw(25) << cos(u)*cos(v) << endl;
+    cout << setw(20) << "dydR" << setw(20) << Jp[1][0] << setw(25) << sin(u)*cos(v) << endl;
+    cout << setw(20) << "dzdR" << setw(20) << Jp[2][0] << setw(25) << sin(v) << endl;
+    cout << setw(20) << "dxdz0" << setw(20) << Jp[0][1] << setw(25) << 0.00 << endl;
+    cout << setw(20) << "dydz0" << setw(20) << Jp[1][1] << setw(25) << 0.00 << endl;
+    cout << setw(20) << "dzdz0" << setw(20) << Jp[2][1] << setw(25) << 1.00 << endl;
+    cout << "Number of traces recorded by the model: " << model.retapes() << endl;
+    cout << endl << endl;
+
+
+
+    /* Observations:
+     *
+     *  The trace with taped parameters is recorded once for the whole sweep, set_param_vec() only copies the new values
+     *  into the parameter store of the trace. Retaping for each value of the radius is much slower
+     *  Both methods give the same Jacobian, the taped parameters do not change the derivatives with respect to x
+     *  A constant is only a parameter if it is created with mkparam() inside the active section. Constants of type
+     *  double (such as the static R of demo_mimo_scalar) are still written into the trace as literal values
+     *  The trace for the derivatives with respect to the parameters is recorded at the first request only, later
+     *  requests with other parameter values reuse it
+     *
+     * */
+
+    myfree2(J);
+    myfree2(J_retape);
+    myfree2(Jp);
+
+    return 0;
+
+
+}
@@ -0,0 +1,356 @@
+// ------------------------------------------------------------------------------------------------------------------ //
+// Example comparing two memory layouts for the Taylor coefficients of a higher-order forward vector sweep
+//
+// The arrays passed to hov_forward() are nested as [variable][direction][degree], so for a fixed degree k the
+// coefficients of the p directions are scattered with a stride equal to the degree. This demo propagates the same
+// univariate Taylor polynomials with hand-written recurrences for exp(), sin() and multiplication using two layouts
+// that can be selected for each sweep:
+//
+//  - AoS (direction-major, degree-minor): coef[dir*d + (k-1)], the same nesting as the hov_forward() arguments
+//  - SoA (degree-major, direction-minor): coef[(k-1)*p + dir], contiguous over the directions
+//
+// With the SoA layout the innermost loop of every recurrence runs over contiguous directions and can be vectorized.
+// The results are verified against hov_forward() and the analytic derivatives.
+//
+// ------------------------------------------------------------------------------------------------------------------ //
+
+
+// Include libraries
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <adolc/adolc.h>
+
+
+// Define namespaces
+using namespace std;                // cout, endl
+using namespace std::chrono;        // nanoseconds, system_clock, seconds
+
+
+// Quick factorial implementation
+int factorial(int n) { return (n == 1 || n == 0) ? 1 : factorial(n - 1) * n; }
+
+
+// Memory layout of the Taylor coefficients
+enum Layout { AoS, SoA };
+
+
+// Position of the Taylor coefficient of order k (1 <= k <= d) along the direction dir
+template<Layout L>
+inline int index(int dir, int k, int p, int d) {
+    return (L == SoA) ? (k-1)*p + dir : dir*d + (k-1);
+}
+
+
+// Truncated Taylor polynomials of one variable along p directions. The zero order coefficient (value) is shared by
+// all the directions and the p*d higher order coefficients are stored according to the layout
+struct Taylor {
+    double value;
+    double *coef;
+};
+
+
+// Set all the higher order coefficients to zero
+void taylor_zero(Taylor &a, int p, int d) {
+    for (int i = 0; i < p*d; ++i) { a.coef[i] = 0.00; }
+}
+
+
+// b = b + a (the recurrence is the same for both layouts)
+void taylor_add(const Taylor &a, Taylor &b, int p, int d) {
+    b.value += a.value;
+    for (int i = 0; i < p*d; ++i) { b.coef[i] += a.coef[i]; }
+}
+
+
+// b = a / c for a passive constant c (the recurrence is the same for both layouts)
+void taylor_div(const Taylor &a, double c, Taylor &b, int p, int d) {
+    b.value = a.value / c;
+    for (int i = 0; i < p*d; ++i) { b.coef[i] = a.coef[i] / c; }
+}
+
+
+// c = a * b using c_k = a_0 b_k + a_k b_0 + sum_{j=1}^{k-1} a_j b_{k-j}
+template<Layout L>
+void taylor_mul(const Taylor &a, const Taylor &b, Taylor &c, int p, int d) {
+    c.value = a.value * b.value;
+    for (int k = 1; k <= d; ++k) {
+        for (int dir = 0; dir < p; ++dir) {
+            c.coef[index<L>(dir, k, p, d)] = a.value*b.coef[index<L>(dir, k, p, d)] + a.coef[index<L>(dir, k, p, d)]*b.value;
+        }
+        for (int j = 1; j < k; ++j) {
+            for (int dir = 0; dir < p; ++dir) {
+                c.coef[index<L>(dir, k, p, d)] += a.coef[index<L>(dir, j, p, d)]*b.coef[index<L>(dir, k-j, p, d)];
+            }
+        }
+    }
+}
+
+
+// b = exp(a) using b_k = 1/k sum_{j=1}^{k} j a_j b_{k-j}
+template<Layout L>
+void taylor_exp(const Taylor &a, Taylor &b, int p, int d) {
+    b.value = exp(a.value);
+    for (int k = 1; k <= d; ++k) {
+        for (int dir = 0; dir < p; ++dir) {
+            b.coef[index<L>(dir, k, p, d)] = a.coef[index<L>(dir, k, p, d)]*b.value;
+        }
+        for (int j = 1; j < k; ++j) {
+            double w = (double) j / k;
+            for (int dir = 0; dir < p; ++dir) {
+                b.coef[index<L>(dir, k, p, d)] += w*a.coef[index<L>(dir, j, p, d)]*b.coef[index<L>(dir, k-j, p, d)];
+            }
+        }
+    }
+}
+
+
+// s = sin(a) and c = cos(a) using s_k = 1/k sum_{j=1}^{k} j a_j c_{k-j} and c_k = -1/k sum_{j=1}^{k} j a_j s_{k-j}
+template<Layout L>
+void taylor_sin_cos(const Taylor &a, Taylor &s, Taylor &c, int p, int d) {
+    s.value = sin(a.value);
+    c.value = cos(a.value);
+    for (int k = 1; k <= d; ++k) {
+        for (int dir = 0; dir < p; ++dir) {
+            s.coef[index<L>(dir, k, p, d)] = +a.coef[index<L>(dir, k, p, d)]*c.value;
+            c.coef[index<L>(dir, k, p, d)] = -a.coef[index<L>(dir, k, p, d)]*s.value;
+        }
+        for (int j = 1; j < k; ++j) {
+            double w = (double) j / k;
+            for (int dir = 0; dir < p; ++dir) {
+                s.coef[index<L>(dir, k, p, d)] += w*a.coef[index<L>(dir, j, p, d)]*c.coef[index<L>(dir, k-j, p, d)];
+                c.coef[index<L>(dir, k, p, d)] -= w*a.coef[index<L>(dir, j, p, d)]*s.coef[index<L>(dir, k-j, p, d)];
+            }
+        }
+    }
+}
+
+
+// Define the function to be differentiated: f(x) = e^s sin(s) with s = (x0+x1+...+xn)/n
+adouble my_function(adouble * x, int n) {
+    adouble sum;
+    for (int i = 0; i < n; ++i) {
+        sum += x[i];
+    }
+    adouble s = sum/n;
+    adouble f = exp(s)*sin(s);
+    return f;
+};
+
+
+// Propagate the Taylor polynomials of the independent variables x through the same function. The array work must
+// contain five temporary Taylor polynomials
+template<Layout L>
+void my_function(const Taylor * x, int n, int p, int d, Taylor * work, Taylor &f) {
+    Taylor &sum = work[0], &s = work[1], &e = work[2], &sn = work[3], &cs = work[4];
+    sum.value = 0.00;
+    taylor_zero(sum, p, d);
+    for (int i = 0; i < n; ++i) {
+        taylor_add(x[i], sum, p, d);
+    }
+    taylor_div(sum, n, s, p, d);
+    taylor_exp<L>(s, e, p, d);
+    taylor_sin_cos<L>(s, sn, cs, p, d);
+    taylor_mul<L>(e, sn, f, p, d);
+}
+
+
+// Seed the Cartesian directions (the first order coefficient of x[i] along direction i is one)
+template<Layout L>
+void seed_directions(const double * xp, Taylor * x, int n, int p, int d) {
+    for (int i = 0; i < n; ++i) {
+        x[i].value = xp[i];
+        taylor_zero(x[i], p, d);
+        if (i < p) { x[i].coef[index<L>(i, 1, p, d)] = 1.00; }
+    }
+}
+
+
+// Higher order forward vector sweep with the layout selected at run time
+void taylor_forward(Layout layout, const double * xp, Taylor * x, int n, int p, int d, Taylor * work, Taylor &f) {
+    if (layout == SoA) {
+        seed_directions<SoA>(xp, x, n, p, d);
+        my_function<SoA>(x, n, p, d, work, f);
+    } else {
+        seed_directions<AoS>(xp, x, n, p, d);
+        my_function<AoS>(x, n, p, d, work, f);
+    }
+}
+
+
+// Read the Taylor coefficient of order k along direction dir with the layout selected at run time
+double taylor_coefficient(Layout layout, const Taylor &f, int dir, int k, int p, int d) {
+    return (layout == SoA) ? f.coef[index<SoA>(dir, k, p, d)] : f.coef[index<AoS>(dir, k, p, d)];
+}
+
+
+// Allocate an array of Taylor polynomials
+Taylor * taylor_alloc(int size, int p, int d) {
+    auto a = new Taylor[size];
+    for (int i = 0; i < size; ++i) {
+        a[i].value = 0.00;
+        a[i].coef = new double[p*d];
+    }
+    return a;
+}
+
+
+int main() {
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Initialize problem variables
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Initialize passive variables
+    int m = 1, n = 100;
+    auto xp = new double[n];    // Independent vector
+    auto yp = new double[m];    // Dependent vector
+
+    // Set the value of the independent variables
+    for (int i = 0; i < n; ++i) {
+        xp[i] = 1.00;
+    }
+
+    // Initialize active variables
+    auto x = new adouble[n];
+    auto y = new adouble[m];
+
+    // Define the number of directions and the order of the highest derivative
+    int p = n, degree = 5;
+
+    // Define the number of repetitions used to measure the time of each sweep
+    int repetitions = 100;
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Active section for automatic differentiation
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Set the tag for the Automatic Differentiation trace
+    int tag = 0;
+
+    // Start tracing floating point operations
+    trace_on(tag);  // Start of the active section
+
+    // Assign independent variables
+    for (int i = 0; i < n; ++i) {
+        x[i] <<= xp[i];
+    }
+
+    // Evaluate the body of the differentiated code (no artificial delay, we want to compare the Taylor arithmetic)
+    y[0] = my_function(x, n);
+
+    // Assign dependent variables
+    y[0] >>= yp[0];
+
+    trace_off();    // End of the active section
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Compute the higher order derivatives with hov_forward (reference)
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Initialize the matrix of tangent directions (identity matrix)
+    double ***X = myalloc3(n, p, degree);
+    for (int i = 0; i < n; ++i) {
+        for (int dir = 0; dir < p; ++dir) {
+            for (int deg = 0; deg < degree; ++deg) {
+                X[i][dir][deg] = (i == dir && deg == 0) ? 1.00 : 0.00;
+            }
+        }
+    }
+
+    // Declare the matrix of Taylor coefficients
+    double ***Y = myalloc3(m, p, degree);
+
+    // Compute the Taylor coefficients several times to measure the time per sweep
+    auto t_start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < repetitions; ++r) {
+        hov_forward(tag, m, n, degree, p, xp, X, yp, Y);
+    }
+    auto t_end = std::chrono::high_resolution_clock::now();
+    double time_adolc = std::chrono::duration<double>(t_end - t_start).count() / repetitions;
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Compute the higher order derivatives with the AoS and SoA layouts
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Allocate the Taylor polynomials once and reuse them for all the sweeps
+    Taylor * xt = taylor_alloc(n, p, degree);
+    Taylor * work = taylor_alloc(5, p, degree);
+    Taylor * f_aos = taylor_alloc(1, p, degree);
+    Taylor * f_soa = taylor_alloc(1, p, degree);
+
+    // Direction-major layout
+    t_start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < repetitions; ++r) {
+        taylor_forward(AoS, xp, xt, n, p, degree, work, f_aos[0]);
+    }
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_aos = std::chrono::duration<double>(t_end - t_start).count() / repetitions;
+
+    // Degree-major layout
+    t_start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < repetitions; ++r) {
+        taylor_forward(SoA, xp, xt, n, p, degree, work, f_soa[0]);
+    }
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_soa = std::chrono::duration<double>(t_end - t_start).count() / repetitions;
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Compare the results
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Compare the derivatives along the first and last directions: d^k f / dx^k = 2^(k/2) e^s sin(s + k pi/4) / n^k
+    double s = 0.00;
+    for (int i = 0; i < n; ++i) { s += xp[i]; }
+    s = s/n;
+    cout << "Higher order derivatives computed with hov_forward and with the AoS and SoA Taylor layouts" << endl;
+    cout << setw(10) << "Order" << setw(12) << "Direction" << setw(20) << "hov_forward" << setw(20) << "AoS layout"
+         << setw(20) << "SoA layout" << setw(25) << "Analytic derivative" << endl;
+    cout.precision(8);
+    cout.setf(ios::scientific);
+    for (int deg = 1; deg <= degree; ++deg) {
+        for (int dir : {0, p-1}) {
+            double analytic = pow(2.00, deg/2.00)*exp(s)*sin(s + deg*M_PI/4)/pow(n, deg);
+            cout << setw(10) << deg << setw(12) << dir+1
+                 << setw(20) << Y[0][dir][deg-1]*factorial(deg)
+                 << setw(20) << taylor_coefficient(AoS, f_aos[0], dir, deg, p, degree)*factorial(deg)
+                 << setw(20) << taylor_coefficient(SoA, f_soa[0], dir, deg, p, degree)*factorial(deg)
+                 << setw(25) << analytic << endl;
+        }
+    }
+    cout << endl;
+
+    // Print the time per sweep
+    cout.unsetf(ios::scientific);
+    cout.setf(ios::fixed);
+    cout.precision(4);
+    cout << "Time per sweep (n = " << n << ", p = " << p << ", degree = " << degree << ")" << endl;
+    cout << setw(20) << "hov_forward" << setw(20) << time_adolc*1000 << " milliseconds" << endl;
+    cout << setw(20) << "AoS layout" << setw(20) << time_aos*1000 << " milliseconds" << endl;
+    cout << setw(20) << "SoA layout" << setw(20) << time_soa*1000 << " milliseconds" << endl;
+    cout << endl << endl;
+
+
+
+    /* Observations:
+     *
+     *  Both layouts perform exactly the same floating point operations and give the same results as hov_forward()
+     *  The SoA layout is faster because the loops over the directions are contiguous and the compiler vectorizes them
+     *  Compile with optimization enabled (e.g., -DCMAKE_BUILD_TYPE=Release) to see the effect of the vectorization
+     *
+     * */
+
+    return 0;
+
+
+}
@@ -0,0 +1,413 @@
+// ------------------------------------------------------------------------------------------------------------------ //
+// Example showing how to integrate an ordinary differential equation with the Taylor series method
+//
+// The right-hand side of the autonomous system x' = f(x) is traced once. The Taylor coefficients of the solution at
+// the beginning of each step are obtained with the forode() driver, which applies the recurrence x_{k+1} = f_k/(k+1),
+// where f_k is the k-th Taylor coefficient of f(x(t)), with one forward sweep per degree. The step size is chosen from
+// the size of the last two coefficients (Jorba and Zou, 2005) and the solution at the end of the step is evaluated
+// with the Horner scheme. The order of the first step is chosen from the tolerance. After each step, the cost per unit
+// time of the orders d-1, d and d+1 is estimated (the coefficient of degree d+1 is extrapolated from the last two) and
+// the next step uses the cheapest order.
+//
+// The sensitivity of the solution with respect to the initial condition (variational equations) is obtained from the
+// same Taylor coefficients: hov_reverse gives the partial derivatives of the coefficients of f with respect to the
+// coefficients of x and accode() accumulates them into the total derivatives dx_{k+1}/dx_0.
+//
+// The method is compared with the adaptive Runge-Kutta method of Dormand and Prince (RK45) on an eccentric Kepler
+// orbit integrated over one period, after which the exact solution returns to the initial condition
+//
+// ------------------------------------------------------------------------------------------------------------------ //
+
+
+// Include libraries
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <adolc/adolc.h>
+
+
+// Define namespaces
+using namespace std;                // cout, endl
+using namespace std::chrono;        // nanoseconds, system_clock, seconds
+
+
+// Define the function to be differentiated: right-hand side of the Kepler problem x = [q1, q2, p1, p2]
+template<typename T>
+void my_function(const T * x, T * f) {
+    T r2 = x[0]*x[0] + x[1]*x[1];
+    T r3 = r2*sqrt(r2);
+    f[0] = x[2];
+    f[1] = x[3];
+    f[2] = -x[0]/r3;
+    f[3] = -x[1]/r3;
+}
+
+
+// Maximum norm of a vector or of the column k of a matrix
+double max_norm(int n, const double * x) {
+    double s = 0.00;
+    for (int i = 0; i < n; ++i) { s = fmax(s, fabs(x[i])); }
+    return s;
+}
+
+double max_norm(int n, double ** X, int k) {
+    double s = 0.00;
+    for (int i = 0; i < n; ++i) { s = fmax(s, fabs(X[i][k])); }
+    return s;
+}
+
+
+// Taylor series integrator for the system traced with the given tag
+class TaylorIntegrator {
+
+public:
+
+    TaylorIntegrator(short tag, int n, double tolerance) : tag(tag), n(n), tolerance(tolerance) {
+        order = min_order = max_order = min(MAX_ORDER, max(2, (int) ceil(-0.50*log(tolerance)) + 1));
+        coef = myalloc2(n, MAX_ORDER + 1);
+        U = myalloc2(n, n);
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) { U[i][j] = (i == j) ? 1.00 : 0.00; }
+        }
+        A = myalloc3(n, n, MAX_ORDER);
+        B = myalloc3(n, n, MAX_ORDER);
+        nz = new short*[n];
+        for (int i = 0; i < n; ++i) { nz[i] = new short[n]; }
+        Phi_step = myalloc2(n, n);
+        Phi_work = myalloc2(n, n);
+    }
+
+    ~TaylorIntegrator() {
+        myfree2(coef); myfree2(U);
+        myfree3(A); myfree3(B); myfree2(Phi_step); myfree2(Phi_work);
+        for (int i = 0; i < n; ++i) { delete[] nz[i]; }
+        delete[] nz;
+    }
+
+    TaylorIntegrator(const TaylorIntegrator &) = delete;
+    TaylorIntegrator & operator=(const TaylorIntegrator &) = delete;
+
+    int get_min_order() const { return min_order; }
+    int get_max_order() const { return max_order; }
+    int get_steps() const { return steps; }
+    int get_sweeps() const { return sweeps; }
+
+    // Integrate from t = 0 to t_end. If Phi is not null, it returns the sensitivity dx(t_end)/dx(0)
+    void integrate(double * x, double t_end, double ** Phi) {
+        if (Phi != nullptr) {
+            for (int i = 0; i < n; ++i) {
+                for (int j = 0; j < n; ++j) { Phi[i][j] = (i == j) ? 1.00 : 0.00; }
+            }
+        }
+        double t = 0.00;
+        while (t < t_end) { t += step(x, t_end - t, Phi); }
+    }
+
+    // Advance x by one step of size h <= h_max and return h. If Phi is not null, it is multiplied by the sensitivity of
+    // the step
+    double step(double * x, double h_max, double ** Phi) {
+
+        int d = order;
+        min_order = min(min_order, d);
+        max_order = max(max_order, d);
+
+        // Taylor coefficients of the solution (the last sweep of forode keeps the Taylor coefficients for hov_reverse)
+        for (int i = 0; i < n; ++i) { coef[i][0] = x[i]; }
+        forode(tag, n, 1.00, d, coef);
+        sweeps += d;
+
+        // Step size from the last two coefficients
+        double epsilon = tolerance*fmax(1.00, max_norm(n, x));
+        double h_order = step_size(d, epsilon, max_norm(n, coef, d - 1), max_norm(n, coef, d));
+        double h = fmin(h_max, h_order);
+
+        // Order of the next step: forode needs sweeps of degree 0, ..., d-1, so the cost of order d is proportional to
+        // d*(d+1)/2 and the cheapest order has the smallest cost per unit time
+        double norms[3] = {max_norm(n, coef, d - 2), max_norm(n, coef, d - 1), max_norm(n, coef, d)};
+        double extrapolated = (norms[1] > 0.00) ? norms[2]*norms[2]/norms[1] : 0.00;
+        double best = d*(d + 1)/(2.00*h_order);
+        if (d > 2) {
+            double h_lower = step_size(d - 1, epsilon, norms[0], norms[1]);
+            if ((d - 1)*d/(2.00*h_lower) < best) { order = d - 1; best = (d - 1)*d/(2.00*h_lower); }
+        }
+        if (d < MAX_ORDER) {
+            double h_higher = step_size(d + 1, epsilon, norms[2], extrapolated);
+            if ((d + 1)*(d + 2)/(2.00*h_higher) < best) { order = d + 1; }
+        }
+
+        // Sensitivity of the step: Phi_step = I + sum_k dx_{k+1}/dx_0 * h^(k+1)
+        if (Phi != nullptr) {
+            hov_reverse(tag, n, n, d - 1, n, U, A, nz);
+            accode(n, 1.00, d - 1, A, B, nz);
+            for (int i = 0; i < n; ++i) {
+                for (int j = 0; j < n; ++j) {
+                    double s = 0.00;
+                    for (int k = d - 1; k >= 0; --k) { s = (s + B[i][j][k])*h; }
+                    Phi_step[i][j] = (i == j) ? 1.00 + s : s;
+                }
+            }
+            for (int i = 0; i < n; ++i) {
+                for (int j = 0; j < n; ++j) {
+                    double s = 0.00;
+                    for (int k = 0; k < n; ++k) { s += Phi_step[i][k]*Phi[k][j]; }
+                    Phi_work[i][j] = s;
+                }
+            }
+            for (int i = 0; i < n; ++i) {
+                for (int j = 0; j < n; ++j) { Phi[i][j] = Phi_work[i][j]; }
+            }
+        }
+
+        // Solution at the end of the step (Horner scheme)
+        for (int i = 0; i < n; ++i) {
+            double s = coef[i][d];
+            for (int k = d - 1; k >= 0; --k) { s = s*h + coef[i][k]; }
+            x[i] = s;
+        }
+        ++steps;
+        return h;
+
+    }
+
+private:
+
+    // Step size of order d from the norms of the coefficients of degree d-1 and d (Jorba and Zou, 2005)
+    static double step_size(int d, double epsilon, double c_lower, double c) {
+        double h = HUGE_VAL;
+        if (c_lower > 0.00) { h = fmin(h, pow(epsilon/c_lower, 1.00/(d - 1))); }
+        if (c > 0.00) { h = fmin(h, pow(epsilon/c, 1.00/d)); }
+        return h*exp(-0.70/(d - 1));
+    }
+
+    static const int MAX_ORDER = 40;
+
+    short tag;
+    int n, order, min_order, max_order;
+    double tolerance;
+    int steps = 0, sweeps = 0;
+    double **coef, **U, ***A, ***B, **Phi_step, **Phi_work;
+    short **nz;
+
+};
+
+
+// Adaptive Runge-Kutta method of Dormand and Prince (order 5 with an embedded error estimate of order 4)
+int rk45(int n, double * x, double t_end, double tolerance, int &evaluations) {
+    static const double a[7][6] = {
+            {0.00},
+            {1.00/5},
+            {3.00/40, 9.00/40},
+            {44.00/45, -56.00/15, 32.00/9},
+            {19372.00/6561, -25360.00/2187, 64448.00/6561, -212.00/729},
+            {9017.00/3168, -355.00/33, 46732.00/5247, 49.00/176, -5103.00/18656},
+            {35.00/384, 0.00, 500.00/1113, 125.00/192, -2187.00/6784, 11.00/84}};
+    static const double b[7] = {35.00/384, 0.00, 500.00/1113, 125.00/192, -2187.00/6784, 11.00/84, 0.00};
+    static const double e[7] = {71.00/57600, 0.00, -71.00/16695, 71.00/1920, -17253.00/339200, 22.00/525, -1.00/40};
+    auto k = myalloc2(7, n);
+    auto xs = new double[n], x_new = new double[n];
+    double t = 0.00, h = 1e-3;
+    int steps = 0;
+    evaluations = 0;
+    while (t < t_end) {
+        h = fmin(h, t_end - t);
+        my_function(x, k[0]);
+        for (int s = 1; s < 7; ++s) {
+            for (int i = 0; i < n; ++i) {
+                double sum = 0.00;
+                for (int j = 0; j < s; ++j) { sum += a[s][j]*k[j][i]; }
+                xs[i] = x[i] + h*sum;
+            }
+            my_function(xs, k[s]);
+        }
+        evaluations += 7;
+        double error = 0.00;
+        for (int i = 0; i < n; ++i) {
+            double sum = 0.00, err = 0.00;
+            for (int s = 0; s < 7; ++s) {
+                sum += b[s]*k[s][i];
+                err += e[s]*k[s][i];
+            }
+            x_new[i] = x[i] + h*sum;
+            error = fmax(error, fabs(h*err)/(tolerance*(1.00 + fmax(fabs(x[i]), fabs(x_new[i])))));
+        }
+        if (error <= 1.00) {
+            t += h;
+            for (int i = 0; i < n; ++i) { x[i] = x_new[i]; }
+            ++steps;
+        }
+        h *= fmin(5.00, fmax(0.20, 0.90*pow(fmax(error, 1e-10), -0.20)));
+    }
+    myfree2(k);
+    delete[] xs;
+    delete[] x_new;
+    return steps;
+}
+
+
+// Determinant of a small matrix with Gaussian elimination (partial pivoting)
+double determinant(int n, double ** M) {
+    auto W = myalloc2(n, n);
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) { W[i][j] = M[i][j]; }
+    }
+    double det = 1.00;
+    for (int j = 0; j < n; ++j) {
+        int p = j;
+        for (int i = j + 1; i < n; ++i) { if (fabs(W[i][j]) > fabs(W[p][j])) { p = i; } }
+        if (p != j) { swap(W[p], W[j]); det = -det; }
+        det *= W[j][j];
+        for (int i = j + 1; i < n; ++i) {
+            double factor = W[i][j]/W[j][j];
+            for (int l = j; l < n; ++l) { W[i][l] -= factor*W[j][l]; }
+        }
+    }
+    myfree2(W);
+    return det;
+}
+
+
+int main() {
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Initialize problem variables
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Kepler orbit with eccentricity 0.5 starting at the pericenter (period 2*pi)
+    int n = 4;
+    double e = 0.50, period = 2.00*M_PI;
+    double x0[4] = {1.00 - e, 0.00, 0.00, sqrt((1.00 + e)/(1.00 - e))};
+    auto xp = new double[n];
+    auto yp = new double[n];
+
+    // Initialize active variables
+    auto x = new adouble[n];
+    auto y = new adouble[n];
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Active section for automatic differentiation
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Set the tag for the Automatic Differentiation trace
+    int tag = 0;
+
+    // Start tracing floating point operations
+    trace_on(tag);  // Start of the active section
+
+    // Assign independent variables
+    for (int i = 0; i < n; ++i) {
+        x[i] <<= x0[i];
+    }
+
+    // Evaluate the body of the differentiated code
+    my_function(x, y);
+
+    // Assign dependent variables
+    for (int i = 0; i < n; ++i) {
+        y[i] >>= yp[i];
+    }
+
+    trace_off();    // End of the active section
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Integrate one period with both methods for several tolerances
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    cout << "Kepler orbit (e = " << e << ") integrated over one period" << endl;
+    cout << setw(10) << "Method" << setw(12) << "Tolerance" << setw(8) << "Order" << setw(10) << "Steps"
+         << setw(16) << "Evaluations" << setw(16) << "Error" << setw(16) << "Time [ms]" << endl;
+
+    for (double tolerance : {1e-6, 1e-10, 1e-14}) {
+
+        // Taylor method (the evaluations are the forward sweeps of forode, one per degree and step)
+        for (int i = 0; i < n; ++i) { xp[i] = x0[i]; }
+        TaylorIntegrator taylor(tag, n, tolerance);
+        auto t_start = std::chrono::high_resolution_clock::now();
+        taylor.integrate(xp, period, nullptr);
+        auto t_end = std::chrono::high_resolution_clock::now();
+        double time_taylor = std::chrono::duration<double>(t_end - t_start).count();
+        double error_taylor = 0.00;
+        for (int i = 0; i < n; ++i) { error_taylor = fmax(error_taylor, fabs(xp[i] - x0[i])); }
+
+        // Runge-Kutta method (the evaluations are calls of the right-hand side)
+        for (int i = 0; i < n; ++i) { xp[i] = x0[i]; }
+        int evaluations;
+        t_start = std::chrono::high_resolution_clock::now();
+        int steps_rk = rk45(n, xp, period, tolerance, evaluations);
+        t_end = std::chrono::high_resolution_clock::now();
+        double time_rk = std::chrono::duration<double>(t_end - t_start).count();
+        double error_rk = 0.00;
+        for (int i = 0; i < n; ++i) { error_rk = fmax(error_rk, fabs(xp[i] - x0[i])); }
+
+        string orders = to_string(taylor.get_min_order()) + "-" + to_string(taylor.get_max_order());
+        cout << setw(10) << "Taylor" << setw(12) << tolerance << setw(8) << orders
+             << setw(10) << taylor.get_steps() << setw(16) << taylor.get_sweeps() << setw(16) << error_taylor
+             << setw(16) << time_taylor*1000 << endl;
+        cout << setw(10) << "RK45" << setw(12) << tolerance << setw(8) << 5 << setw(10) << steps_rk
+             << setw(16) << evaluations << setw(16) << error_rk << setw(16) << time_rk*1000 << endl;
+
+    }
+    cout << endl;
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Variational equations: sensitivity of the final state with respect to the initial state
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    double tolerance = 1e-12, h = 1e-6;
+    double **Phi = myalloc2(n, n);
+    for (int i = 0; i < n; ++i) { xp[i] = x0[i]; }
+    TaylorIntegrator taylor(tag, n, tolerance);
+    taylor.integrate(xp, period, Phi);
+
+    // Central finite differences of the final state with respect to each initial state
+    double error_fd = 0.00;
+    auto x_plus = new double[n], x_minus = new double[n];
+    for (int j = 0; j < n; ++j) {
+        for (int i = 0; i < n; ++i) { x_plus[i] = x_minus[i] = x0[i]; }
+        x_plus[j] += h;
+        x_minus[j] -= h;
+        TaylorIntegrator taylor_plus(tag, n, tolerance), taylor_minus(tag, n, tolerance);
+        taylor_plus.integrate(x_plus, period, nullptr);
+        taylor_minus.integrate(x_minus, period, nullptr);
+        for (int i = 0; i < n; ++i) { error_fd = fmax(error_fd, fabs(Phi[i][j] - (x_plus[i] - x_minus[i])/(2*h))); }
+    }
+
+    cout << "Sensitivity of the final state with respect to the initial state" << endl;
+    cout.precision(6);
+    cout.setf(ios::fixed);
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) { cout << setw(16) << Phi[i][j]; }
+        cout << endl;
+    }
+    cout.unsetf(ios::fixed);
+    cout << "Determinant (1 for a Hamiltonian system): " << determinant(n, Phi) << endl;
+    cout << "Maximum difference with the finite difference approximation: " << error_fd << endl;
+    cout << endl << endl;
+
+
+
+    /* Observations:
+     *
+     *  The order of the Taylor method grows with the logarithm of the tolerance and the step size remains large, so
+     *  the number of steps hardly changes when the tolerance is reduced
+     *  The order changes along the orbit (the range of orders is printed): close to the pericenter the coefficients
+     *  grow faster and the cost per unit time favors a different order than at the apocenter
+     *  The number of steps of RK45 grows as tolerance^(-1/5), the method becomes expensive at tight tolerances
+     *  Each step of the Taylor method needs one forward sweep per degree inside forode(), so the cost of a step grows
+     *  with the square of the order
+     *  The sensitivity of a Hamiltonian flow is symplectic, its determinant is one up to the integration error
+     *
+     * */
+
+    return 0;
+
+
+}
@@ -0,0 +1,329 @@
+// ------------------------------------------------------------------------------------------------------------------ //
+// Example showing how to compute a gradient in traceless forward mode propagating the directions in chunks
+//
+// demo_traceless_scalar evaluates the function n times with one direction each and demo_traceless_vector evaluates it
+// once with n directions, which needs n derivatives for every intermediate adouble. The chunked driver of this demo
+// evaluates the function ceil(n/C) times with C directions each: the cost of the function values is divided by C with
+// respect to the scalar mode and every intermediate variable only stores C derivatives.
+//
+// The general chunked driver works with any function written for adtl::adouble: it sets the number of directions to C
+// with adtl::setNumDir() and seeds C unit directions per evaluation. The specialization for the functions that only use
+// + - * exp and the division by a constant uses the forward type Tangents<C>, where the chunk size is a template
+// parameter, so the derivatives are stored in a fixed array (no allocation) and the loops over the directions have a
+// constant trip count that the compiler vectorizes.
+//
+// The default chunk is the largest power-of-two multiple of the SIMD width for which the derivatives of LIVE_TANGENTS
+// variables fill at most half of the L1 data cache (ADOLC_L1_CACHE bytes). The chunk and the cache size can be changed
+// with -DADOLC_CHUNK=<C> and -DADOLC_L1_CACHE=<bytes> (see CMakeLists.txt).
+//
+// ------------------------------------------------------------------------------------------------------------------ //
+
+
+// Include libraries
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <adolc/adtl.h>             // Header for traceless ADOL-C!
+
+
+// Define namespaces
+using namespace std;                // cout, endl
+using namespace std::chrono;        // nanoseconds, system_clock, seconds
+
+
+// Number of doubles in one SIMD register of the target
+#if defined(__AVX512F__)
+const int SIMD_DOUBLES = 8;
+#elif defined(__AVX__)
+const int SIMD_DOUBLES = 4;
+#elif defined(__SSE2__) || defined(__ARM_NEON)
+const int SIMD_DOUBLES = 2;
+#else
+const int SIMD_DOUBLES = 1;
+#endif
+
+// Size of the L1 data cache of the target in bytes
+#ifndef ADOLC_L1_CACHE
+#define ADOLC_L1_CACHE 32768
+#endif
+
+// Estimate of the number of variables whose derivatives are used at the same time: the temporaries of one iteration
+// of my_function, the accumulators and the elements of x that are read
+const int LIVE_TANGENTS = 16;
+
+// Largest power-of-two multiple of the SIMD width for which LIVE_TANGENTS values with their derivatives fill at most
+// half of the L1 cache
+constexpr int cache_chunk(int chunk = SIMD_DOUBLES) {
+    return (LIVE_TANGENTS*(2*chunk + 1)*(int) sizeof(double) <= ADOLC_L1_CACHE/2) ? cache_chunk(2*chunk) : chunk;
+}
+
+// Default chunk size
+#ifndef ADOLC_CHUNK
+#define ADOLC_CHUNK cache_chunk()
+#endif
+
+
+// Traceless forward type with a value and C directional derivatives
+template<int C>
+struct Tangents {
+
+    double v;
+    double d[C];
+
+    Tangents(double value = 0.00) : v(value) { for (int p = 0; p < C; ++p) { d[p] = 0.00; } }
+
+    Tangents & operator+=(const Tangents &b) {
+        v += b.v;
+        for (int p = 0; p < C; ++p) { d[p] += b.d[p]; }
+        return *this;
+    }
+
+};
+
+template<int C>
+Tangents<C> operator+(const Tangents<C> &a, const Tangents<C> &b) {
+    Tangents<C> r(a.v + b.v);
+    for (int p = 0; p < C; ++p) { r.d[p] = a.d[p] + b.d[p]; }
+    return r;
+}
+
+template<int C>
+Tangents<C> operator-(const Tangents<C> &a, const Tangents<C> &b) {
+    Tangents<C> r(a.v - b.v);
+    for (int p = 0; p < C; ++p) { r.d[p] = a.d[p] - b.d[p]; }
+    return r;
+}
+
+template<int C>
+Tangents<C> operator*(const Tangents<C> &a, const Tangents<C> &b) {
+    Tangents<C> r(a.v*b.v);
+    for (int p = 0; p < C; ++p) { r.d[p] = b.v*a.d[p] + a.v*b.d[p]; }
+    return r;
+}
+
+template<int C>
+Tangents<C> operator*(double c, const Tangents<C> &a) {
+    Tangents<C> r(c*a.v);
+    for (int p = 0; p < C; ++p) { r.d[p] = c*a.d[p]; }
+    return r;
+}
+
+template<int C>
+Tangents<C> operator-(const Tangents<C> &a, double c) {
+    Tangents<C> r(a);
+    r.v -= c;
+    return r;
+}
+
+template<int C>
+Tangents<C> operator/(const Tangents<C> &a, double c) { return (1.00/c)*a; }
+
+template<int C>
+Tangents<C> exp(const Tangents<C> &a) {
+    Tangents<C> r(std::exp(a.v));
+    for (int p = 0; p < C; ++p) { r.d[p] = r.v*a.d[p]; }
+    return r;
+}
+
+
+// Define the function to be differentiated: generalized Rosenbrock function plus e^[(x0+x1+...+xn)/n]
+template<typename T>
+void my_function(const T * x, int n, T * f) {
+    T sum = 0.00, rosenbrock = 0.00;
+    for (int i = 0; i < n; ++i) {
+        sum += x[i];
+    }
+    for (int i = 0; i < n-1; ++i) {
+        T a = x[i+1] - x[i]*x[i];
+        T b = x[i] - 1.00;
+        rosenbrock += 100.00*a*a + b*b;
+    }
+    f[0] = rosenbrock + exp(sum/n);
+}
+
+
+// Jacobian of f: R^n -> R^m with adtl::adouble and ceil(n/C) evaluations of C directions each. This is the general
+// driver, any function written for adtl::adouble can be evaluated with it
+void jacobian_chunked(int m, int n, int C, const double * xp, double ** J) {
+    adtl::setNumDir(C);
+    vector<adtl::adouble> x(n), f(m);
+    for (int i = 0; i < n; ++i) { x[i].setValue(xp[i]); }
+    for (int k = 0; k < n; k += C) {
+        int width = min(C, n - k);
+        for (int p = 0; p < width; ++p) { x[k + p].setADValue(p, 1.00); }
+        my_function(x.data(), n, f.data());
+        for (int p = 0; p < width; ++p) { x[k + p].setADValue(p, 0.00); }
+        for (int i = 0; i < m; ++i) {
+            for (int p = 0; p < width; ++p) { J[i][k + p] = f[i].getADValue(p); }
+        }
+    }
+}
+
+
+// Same driver with the forward type Tangents<C> (specialization for the operations implemented by Tangents)
+template<int C>
+void jacobian_chunked(int m, int n, const double * xp, double ** J) {
+    vector<Tangents<C>> x(n), f(m);
+    for (int i = 0; i < n; ++i) { x[i] = Tangents<C>(xp[i]); }
+    for (int k = 0; k < n; k += C) {
+        int width = min(C, n - k);
+        for (int p = 0; p < width; ++p) { x[k + p].d[p] = 1.00; }
+        my_function(x.data(), n, f.data());
+        for (int p = 0; p < width; ++p) { x[k + p].d[p] = 0.00; }
+        for (int i = 0; i < m; ++i) {
+            for (int p = 0; p < width; ++p) { J[i][k + p] = f[i].d[p]; }
+        }
+    }
+}
+
+
+// Gradient with adtl::adouble and one direction per evaluation (as in demo_traceless_scalar)
+void gradient_scalar(int n, const double * xp, double * g) {
+    adtl::setNumDir(1);
+    vector<adtl::adouble> x(n), f(1);
+    for (int i = 0; i < n; ++i) { x[i].setValue(xp[i]); }
+    for (int i = 0; i < n; ++i) {
+        x[i].setADValue(0, 1.00);
+        my_function(x.data(), n, f.data());
+        x[i].setADValue(0, 0.00);
+        g[i] = f[0].getADValue(0);
+    }
+}
+
+
+// Gradient with adtl::adouble and all the directions in one evaluation (as in demo_traceless_vector)
+void gradient_vector(int n, const double * xp, double * g) {
+    adtl::setNumDir(n);
+    vector<adtl::adouble> x(n), f(1);
+    for (int i = 0; i < n; ++i) {
+        x[i].setValue(xp[i]);
+        for (int j = 0; j < n; ++j) { x[i].setADValue(j, i == j ? 1.00 : 0.00); }
+    }
+    my_function(x.data(), n, f.data());
+    for (int i = 0; i < n; ++i) { g[i] = f[0].getADValue(i); }
+}
+
+
+// Time the chunked gradient with chunk size C and return the maximum difference with the reference gradient
+template<int C>
+double time_chunk(int n, const double * xp, const double * g_reference, int repetitions, double &time) {
+    vector<double> g(n);
+    double * J[1] = {g.data()};
+    auto t_start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < repetitions; ++r) { jacobian_chunked<C>(1, n, xp, J); }
+    auto t_end = std::chrono::high_resolution_clock::now();
+    time = std::chrono::duration<double>(t_end - t_start).count() / repetitions;
+    double error = 0.00;
+    for (int i = 0; i < n; ++i) { error = fmax(error, fabs(g[i] - g_reference[i])); }
+    return error;
+}
+
+
+int main() {
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Initialize problem variables
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // Set the desired number of independent variables
+    const int n = 1000;
+    int repetitions = 10;
+
+    // Initialize passive variables
+    vector<double> xp(n), g_scalar(n), g_vector(n);
+    for (int i = 0; i < n; ++i) {
+        xp[i] = (i % 2 == 0) ? -1.20 : 1.00;
+    }
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Compute the gradient with adtl::adouble (scalar and vector modes)
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    // The adoubles of each mode are destroyed before the number of directions is changed again
+    auto t_start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < repetitions; ++r) { gradient_scalar(n, xp.data(), g_scalar.data()); }
+    auto t_end = std::chrono::high_resolution_clock::now();
+    double time_scalar = std::chrono::duration<double>(t_end - t_start).count() / repetitions;
+
+    t_start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < repetitions; ++r) { gradient_vector(n, xp.data(), g_vector.data()); }
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_vector = std::chrono::duration<double>(t_end - t_start).count() / repetitions;
+
+    double error_vector = 0.00;
+    for (int i = 0; i < n; ++i) { error_vector = fmax(error_vector, fabs(g_vector[i] - g_scalar[i])); }
+
+    // General chunked driver with the default chunk
+    vector<double> g_chunked(n);
+    double * J_chunked[1] = {g_chunked.data()};
+    t_start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < repetitions; ++r) { jacobian_chunked(1, n, ADOLC_CHUNK, xp.data(), J_chunked); }
+    t_end = std::chrono::high_resolution_clock::now();
+    double time_chunked = std::chrono::duration<double>(t_end - t_start).count() / repetitions;
+
+    double error_chunked = 0.00;
+    for (int i = 0; i < n; ++i) { error_chunked = fmax(error_chunked, fabs(g_chunked[i] - g_scalar[i])); }
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Compute the gradient with the chunked driver specialized for Tangents<C>
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    const int chunks = 7;
+    int sizes[chunks] = {1, 2, 4, 8, 16, 32, ADOLC_CHUNK};
+    double times[chunks], errors[chunks];
+    errors[0] = time_chunk<1>(n, xp.data(), g_scalar.data(), repetitions, times[0]);
+    errors[1] = time_chunk<2>(n, xp.data(), g_scalar.data(), repetitions, times[1]);
+    errors[2] = time_chunk<4>(n, xp.data(), g_scalar.data(), repetitions, times[2]);
+    errors[3] = time_chunk<8>(n, xp.data(), g_scalar.data(), repetitions, times[3]);
+    errors[4] = time_chunk<16>(n, xp.data(), g_scalar.data(), repetitions, times[4]);
+    errors[5] = time_chunk<32>(n, xp.data(), g_scalar.data(), repetitions, times[5]);
+    errors[6] = time_chunk<ADOLC_CHUNK>(n, xp.data(), g_scalar.data(), repetitions, times[6]);
+
+
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Print the results
+    // -------------------------------------------------------------------------------------------------------------- //
+
+    cout.precision(8);
+    cout.setf(ios::fixed);
+    cout << "Gradient in traceless forward mode (n = " << n << ", SIMD width = " << SIMD_DOUBLES
+         << " doubles, L1 cache = " << ADOLC_L1_CACHE/1024 << " kB)" << endl;
+    cout << setw(25) << "Method" << setw(20) << "Evaluations" << setw(20) << "Time [ms]" << setw(20) << "Difference" << endl;
+    cout << setw(25) << "adtl scalar" << setw(20) << n << setw(20) << time_scalar*1000 << setw(20) << 0.00 << endl;
+    cout << setw(25) << "adtl vector" << setw(20) << 1 << setw(20) << time_vector*1000 << setw(20) << error_vector << endl;
+    cout << setw(25) << "adtl chunk C = " + to_string(ADOLC_CHUNK) << setw(20) << (n + ADOLC_CHUNK - 1)/ADOLC_CHUNK
+         << setw(20) << time_chunked*1000 << setw(20) << error_chunked << endl;
+    for (int k = 0; k < chunks; ++k) {
+        string label = "Tangents C = " + to_string(sizes[k]) + (k == chunks - 1 ? " (default)" : "");
+        cout << setw(25) << label << setw(20) << (n + sizes[k] - 1)/sizes[k] << setw(20) << times[k]*1000
+             << setw(20) << errors[k] << endl;
+    }
+    cout << endl << endl;
+
+
+
+    /* Observations:
+     *
+     *  The scalar mode evaluates the function n times, so the cost of the function values dominates for large n
+     *  The vector mode evaluates the function once, but each intermediate adouble allocates and writes n derivatives,
+     *  which do not fit in the cache for large n
+     *  The chunked driver is faster than both extremes for a range of chunk sizes around a few SIMD registers. Very
+     *  small chunks repeat the function values too often and very large chunks lose the cache locality
+     *  The general driver with adtl::adouble allocates the derivatives of every intermediate variable, Tangents<C>
+     *  keeps them in fixed arrays and is faster for the same chunk, but only implements the operations of my_function
+     *  Compile with optimization and -march=native so that the compiler uses the SIMD width of the machine
+     *
+     * */
+
+    return 0;
+
+
+}